@@ -0,0 +1,371 @@
+/**
+  \file CommandParser.cpp
+  \brief CommandParser class decodes the master commands as described by the
+  commands table.
+  */
+
+#include "CommandParser.h"
+#include "ParserErrors.h"
+#include <string.h>
+
+/**
+  \brief Class constructor
+  
+  Builds the lookup table of the command characters, so every command is found
+  with a single access.
+  
+  \param table The commands table. The table should remain valid for the class
+  instance life
+  \param numCommands The number of commands in the table
+  */
+CommandParser::CommandParser(const commandSpec* table, int numCommands) {
+  int j;
+
+  commands = table;
+  state = PARSE_COMMAND;
+  isLineStart = true;
+  sequence = NO_SEQUENCE;
+  spec = NULL;
+  result = COMMAND_OK;
+  textUsed = 0;
+  for (j = 0; j < CMD_LOOKUP_SIZE; j++)
+    lookup[j] = CMD_NOT_FOUND;
+
+  for (j = 0; j < numCommands; j++) {
+    int index = table[j].name - CMD_FIRST_CHAR;
+    if ( (index >= 0) && (index < CMD_LOOKUP_SIZE) )
+      lookup[index] = j;
+  }
+}
+
+/**
+  \brief Search a command in the commands table
+  
+  \param name The command character
+  \return The command description or NULL if the command is unknown
+  */
+const commandSpec* CommandParser::find(char name) {
+  int index = name - CMD_FIRST_CHAR;
+
+  if ( (index < 0) || (index >= CMD_LOOKUP_SIZE) || (lookup[index] == CMD_NOT_FOUND) )
+    return NULL;
+
+  return &commands[lookup[index]];
+}
+
+/**
+  \brief Decode the next character of the ASCII commands
+  
+  The characters outside a command are skipped, so any kind of comment can be
+  included between two commands. When a command ends (CMD_SEPARATOR or
+  CMD_LINE_END) its result code is returned and the decoded command is
+  available with getCommand(). The characters following a wrong field are
+  skipped until the command end.
+  
+  \param c The received character
+  \param cmd Returns the decoded values of the command being received
+  \return PARSE_PENDING or the result code of the command ended by c
+  */
+int CommandParser::feed(char c, command& cmd) {
+  if (c == '\n')
+    return PARSE_PENDING;
+
+  if (isLineStart) {
+    isLineStart = false;
+    sequence = NO_SEQUENCE;
+    if (c == SEQUENCE_MARKER) {
+      state = PARSE_SEQUENCE;
+      digits = 0;
+      value = 0;
+      return PARSE_PENDING;
+    } // The line starts with the sequence ID
+  } // New line
+
+  if ( (c == CMD_LINE_END) || ( (c == CMD_SEPARATOR) && (state != PARSE_STRING) ) ) {
+    isLineStart = c == CMD_LINE_END;
+    if ( (state == PARSE_COMMAND) || (state == PARSE_SEQUENCE) ) {
+      state = PARSE_COMMAND;
+      return PARSE_PENDING;
+    } // No command
+
+    if ( (state != PARSE_END) && (state != PARSE_MORE_STRINGS) )
+      fail(state == PARSE_SEPARATOR ? COMMAND_MISSINGSEPARATOR : COMMAND_WRONG);
+    state = PARSE_COMMAND;
+    return result;
+  } // Command end
+
+  switch (state) {
+    case PARSE_COMMAND:
+      spec = find(c);
+      if (spec != NULL) {
+        clear(cmd);
+        field = 0;
+        result = COMMAND_OK;
+        textUsed = 0;
+        state = spec->numFields > 0 ? PARSE_SEPARATOR : PARSE_END;
+      } // Command character
+      break;
+
+    case PARSE_SEQUENCE:
+      if ( (c < '0') || (c > '9') ) {
+        state = PARSE_COMMAND;
+        return feed(c, cmd);
+      } // Not a sequence ID
+      value = value * 10 + (c - '0');
+      if (++digits == PARM_SEQUENCE_LEN) {
+        sequence = value;
+        state = PARSE_COMMAND;
+      } // Sequence ID completed
+      break;
+
+    case PARSE_SEPARATOR:
+      if (c == FIELD_SEPARATOR)
+        beginField();
+      else
+        fail(COMMAND_MISSINGSEPARATOR);
+      break;
+
+    case PARSE_FIELD:
+      readFieldChar(c, cmd);
+      break;
+
+    case PARSE_QUOTE:
+      if ( (c != STRING_DELIMITER) || (cmd.numStrings == CMD_MAX_STRINGS) ) {
+        fail(COMMAND_WRONG);
+        break;
+      } // Not a string
+      cmd.stringValue[cmd.numStrings] = textPool + textUsed;
+      state = PARSE_STRING;
+      break;
+
+    case PARSE_STRING:
+      if (textUsed == CMD_TEXT_POOL - 1) {
+        fail(COMMAND_WRONG);
+        break;
+      } // String too long
+      if (c != STRING_DELIMITER) {
+        textPool[textUsed++] = c;
+        break;
+      } // String character
+      textPool[textUsed++] = '\0';
+      cmd.numStrings++;
+      if (spec->fields[field].type == FIELD_STRINGS)
+        state = PARSE_MORE_STRINGS;
+      else
+        endField();
+      break;
+
+    case PARSE_MORE_STRINGS:
+      // Anything else than another string ends the list
+      state = c == FIELD_SEPARATOR ? PARSE_QUOTE : PARSE_END;
+      break;
+
+    default:
+      break;
+  } // Parser states
+
+  return PARSE_PENDING;
+}
+
+/**
+  \brief Return the description of the last ended ASCII command
+  */
+const commandSpec* CommandParser::getCommand() {
+  return spec;
+}
+
+/**
+  \brief Return the sequence ID of the ASCII command line being received
+  
+  \return The sequence ID or NO_SEQUENCE
+  */
+int CommandParser::getSequence() {
+  return sequence;
+}
+
+/**
+  \brief Decode the fields of a binary frame
+  
+  \param spec The command description
+  \param frame The decoded frame, positioned on the first field
+  \param cmd Returns the decoded values. The strings are valid until the
+  next decoded frame
+  \return COMMAND_OK or the error code of the first wrong field
+  */
+int CommandParser::decodeFrame(const commandSpec& spec, LinkFrame& frame, command& cmd) {
+  int result = COMMAND_OK;
+  int used = 0;
+  uint8_t byteValue;
+  int16_t intValue;
+  bool boolValue;
+
+  clear(cmd);
+
+  for (int j = 0; (j < spec.numFields) && (result == COMMAND_OK); j++) {
+    const commandField& field = spec.fields[j];
+
+    switch (field.type) {
+      case FIELD_ID:
+        if (!frame.readUInt8(byteValue))
+          return COMMAND_WRONG;
+        result = checkInt(field, byteValue);
+        cmd.intValue[cmd.numInts++] = byteValue;
+        break;
+
+      case FIELD_INT:
+        if (!frame.readInt16(intValue))
+          return COMMAND_WRONG;
+        result = checkInt(field, intValue);
+        cmd.intValue[cmd.numInts++] = intValue;
+        break;
+
+      case FIELD_BOOL:
+        if (!frame.readBool(boolValue))
+          return COMMAND_WRONG;
+        cmd.booleanValue = boolValue;
+        break;
+
+      case FIELD_SUBCOMMAND:
+        if (!frame.readUInt8(byteValue))
+          return COMMAND_WRONG;
+        result = checkSubcommand(spec, byteValue);
+        cmd.subcommand[0] = byteValue;
+        break;
+
+      case FIELD_STRING:
+      case FIELD_STRINGS:
+        do {
+          if ( (cmd.numStrings == CMD_MAX_STRINGS) ||
+              !frame.readString(stringPool + used, CMD_STRING_POOL - used) )
+            return COMMAND_WRONG;
+          cmd.stringValue[cmd.numStrings++] = stringPool + used;
+          used += strlen(stringPool + used) + 1;
+        } while ( (field.type == FIELD_STRINGS) && !frame.isEnd() );
+        break;
+
+      default:
+        result = COMMAND_WRONG;
+        break;
+    } // Field types
+  } // Decode the fields
+
+  return result;
+}
+
+/**
+  \brief Reset the decoded values of the command structure
+  */
+void CommandParser::clear(command& cmd) {
+  cmd.subcommand[0] = '\0';
+  cmd.numInts = 0;
+  cmd.numStrings = 0;
+  cmd.booleanValue = false;
+}
+
+/**
+  \brief Check an integer field value against the field limit
+  
+  \return COMMAND_OK or the field error code
+  */
+int CommandParser::checkInt(const commandField& field, int value) {
+  if ( (field.limit != 0) && ( (value < 0) || (value >= field.limit) ) )
+    return field.error;
+
+  return COMMAND_OK;
+}
+
+/**
+  \brief Check if a subcommand is accepted by a command
+  
+  \return COMMAND_OK or PARSER_SUBCOMMAND_UNKNOWN
+  */
+int CommandParser::checkSubcommand(const commandSpec& spec, char subcommand) {
+  if ( (spec.subcommands == NULL) || (subcommand == '\0') ||
+      (strchr(spec.subcommands, subcommand) == NULL) )
+    return PARSER_SUBCOMMAND_UNKNOWN;
+
+  return COMMAND_OK;
+}
+
+/**
+  \brief Start reading the current field of the ASCII command
+  */
+void CommandParser::beginField() {
+  digits = 0;
+  value = 0;
+  if ( (spec->fields[field].type == FIELD_STRING) ||
+      (spec->fields[field].type == FIELD_STRINGS) )
+    state = PARSE_QUOTE;
+  else
+    state = PARSE_FIELD;
+}
+
+/**
+  \brief Move to the next field of the ASCII command
+  */
+void CommandParser::endField() {
+  field++;
+  state = field < spec->numFields ? PARSE_SEPARATOR : PARSE_END;
+}
+
+/**
+  \brief Stop decoding the ASCII command with an error
+  
+  The command is skipped until its end, then the error is returned.
+  
+  \param error The error code
+  */
+void CommandParser::fail(int error) {
+  if (result == COMMAND_OK)
+    result = error;
+  state = PARSE_END;
+}
+
+/**
+  \brief Decode a character of a fixed length ASCII field
+  
+  \param c The received character
+  \param cmd Returns the field value when the field is completed
+  */
+void CommandParser::readFieldChar(char c, command& cmd) {
+  const commandField& current = spec->fields[field];
+  int error;
+
+  switch (current.type) {
+    case FIELD_ID:
+    case FIELD_INT:
+      if ( (c < '0') || (c > '9') ) {
+        fail(COMMAND_WRONG);
+        return;
+      } // Not a digit
+      value = value * 10 + (c - '0');
+      if (++digits < (current.type == FIELD_ID ? PARM_FIELDID_LEN : PARM_INTEGER_LEN))
+        return;
+      cmd.intValue[cmd.numInts++] = value;
+      error = checkInt(current, value);
+      break;
+
+    case FIELD_BOOL:
+      if ( (c < '0') || (c > '9') ) {
+        fail(COMMAND_WRONG);
+        return;
+      } // Not a digit
+      cmd.booleanValue = c != '0';
+      error = COMMAND_OK;
+      break;
+
+    case FIELD_SUBCOMMAND:
+      cmd.subcommand[0] = c;
+      error = checkSubcommand(*spec, c);
+      break;
+
+    default:
+      error = COMMAND_WRONG;
+      break;
+  } // Field types
+
+  if (error != COMMAND_OK)
+    fail(error);
+  else
+    endField();
+}
@@ -0,0 +1,174 @@
+/**
+  \file CommandParser.h
+  \brief Table-driven decoder of the master commands.
+  
+  Every command accepted by the board is described once in a commandSpec table
+  entry: the command character, the accepted subcommands, the list of its typed
+  fields and the handler executing it. The CommandParser class decodes the
+  fields of both the ASCII commands and the binary frames (see LinkProtocol.h)
+  into the command structure, validating them as described by the table, so the
+  handlers receive the values already checked. The decoding does not create any
+  String object: the strings are copied in fixed buffers of the parser.
+  
+  The ASCII commands are decoded by a state machine fed with one character at
+  a time as it is received from the serial port (see feed()): the fields are
+  validated and the integers converted while the command is received, so the
+  command is ready to be executed as soon as its CMD_SEPARATOR or CMD_LINE_END
+  terminator arrives and the line is never stored nor scanned again.
+  
+  The ASCII fields are separated by FIELD_SEPARATOR and have a fixed length,
+  except the strings that are enclosed by STRING_DELIMITER. The binary fields
+  have the LinkProtocol type corresponding to the field type.
+  
+  \verbatim
+  Field type        ASCII                       Binary
+  FIELD_ID          PARM_FIELDID_LEN digits     LINK_FIELD_UINT8
+  FIELD_INT         PARM_INTEGER_LEN digits     LINK_FIELD_INT16
+  FIELD_BOOL        one digit, 0 is false       LINK_FIELD_BOOL
+  FIELD_SUBCOMMAND  one character               LINK_FIELD_UINT8
+  FIELD_STRING      "string"                    LINK_FIELD_STRING
+  FIELD_STRINGS     zero or more strings until the end of the command
+  \endverbatim
+  */
+
+#ifndef __COMMANDPARSER_H__
+#define __COMMANDPARSER_H__
+
+#include "CommandProcessor.h"
+#include "LinkProtocol.h"
+
+//! Field type: identifier, stored in the next intValue
+#define FIELD_ID 'c'
+//! Field type: integer, stored in the next intValue
+#define FIELD_INT 'i'
+//! Field type: boolean, stored in booleanValue
+#define FIELD_BOOL 'b'
+//! Field type: subcommand character, stored in subcommand
+#define FIELD_SUBCOMMAND 'u'
+//! Field type: string, stored in the next stringValue
+#define FIELD_STRING 's'
+//! Field type: list of strings, stored in the next stringValues
+#define FIELD_STRINGS 'S'
+
+//! Max number of fields of a command
+#define CMD_MAX_FIELDS 3
+
+//! End of the ASCII command line. The new line characters are ignored
+#define CMD_LINE_END '\r'
+
+//! feed() result while the command is not complete
+#define PARSE_PENDING -1
+
+//! Size of the buffer of the strings of the ASCII command being received
+#define CMD_TEXT_POOL (CMD_MAX_STRINGS * (CMD_MSGLEN + 1))
+
+// ASCII parser states
+//! Waiting for a command character (anything else is skipped)
+#define PARSE_COMMAND 0
+//! Reading the sequence ID digits at the line start
+#define PARSE_SEQUENCE 1
+//! Waiting for the field separator before the next field
+#define PARSE_SEPARATOR 2
+//! Reading a fixed length field
+#define PARSE_FIELD 3
+//! Waiting for the opening string delimiter
+#define PARSE_QUOTE 4
+//! Reading the string characters
+#define PARSE_STRING 5
+//! After a string of a list, waiting for a separator or the command end
+#define PARSE_MORE_STRINGS 6
+//! Fields completed (or wrong), skipping until the command end
+#define PARSE_END 7
+
+//! Size of the buffer of the strings decoded from a binary frame
+#define CMD_STRING_POOL LINK_MAX_PAYLOAD
+
+// The buffers should contain at least a full message string and a response
+// should fit in a binary response frame
+STATIC_CHECK(CMD_TEXT_POOL >= CMD_MSGLEN + 1, textPoolCapacity);
+STATIC_CHECK(CMD_STRING_POOL >= CMD_MSGLEN + 1, stringPoolCapacity);
+STATIC_CHECK(CMD_RESPONSE_LEN <= LINK_MAX_STRING, responseCapacity);
+
+//! First character of the command lookup table
+#define CMD_FIRST_CHAR 'A'
+//! Number of characters of the command lookup table (from 'A' to 'z')
+#define CMD_LOOKUP_SIZE ('z' - CMD_FIRST_CHAR + 1)
+//! Lookup table value of the characters not corresponding to a command
+#define CMD_NOT_FOUND 0xFF
+
+/**
+  \brief A command field description
+  */
+typedef struct CommandField {
+  //! The field type (FIELD_ID, FIELD_INT etc.)
+  char type;
+  //! For the integer fields, the value should be lower than the limit.
+  //! No check if 0
+  int16_t limit;
+  //! The error code of a value out of the limit
+  uint8_t error;
+} commandField;
+
+/**
+  \brief A command description
+  */
+typedef struct CommandSpec {
+  //! The command character
+  char name;
+  //! The accepted subcommand characters or NULL
+  const char* subcommands;
+  //! Number of fields
+  uint8_t numFields;
+  //! The fields, in the order they are sent
+  commandField fields[CMD_MAX_FIELDS];
+  //! Execute the decoded command and return the result code (ParserErrors.h)
+  int (*handler)(command& cmd);
+} commandSpec;
+
+class CommandParser {
+  public:
+    CommandParser(const commandSpec* table, int numCommands);
+    const commandSpec* find(char name);
+    int feed(char c, command& cmd);
+    const commandSpec* getCommand();
+    int getSequence();
+    int decodeFrame(const commandSpec& spec, LinkFrame& frame, command& cmd);
+  private:
+    //! The commands table
+    const commandSpec* commands;
+    //! Index of every command character in the commands table
+    uint8_t lookup[CMD_LOOKUP_SIZE];
+    //! The strings decoded from the last binary frame
+    char stringPool[CMD_STRING_POOL];
+    
+    //! ASCII parser: the current state (PARSE_COMMAND etc.)
+    uint8_t state;
+    //! ASCII parser: true if the next character starts a new line
+    bool isLineStart;
+    //! ASCII parser: the sequence ID of the current line or NO_SEQUENCE
+    int sequence;
+    //! ASCII parser: the command being received
+    const commandSpec* spec;
+    //! ASCII parser: the current field of the command
+    uint8_t field;
+    //! ASCII parser: number of characters read of the current field
+    uint8_t digits;
+    //! ASCII parser: the value of the current field
+    int value;
+    //! ASCII parser: the result code of the command being received
+    int result;
+    //! ASCII parser: the strings of the command being received
+    char textPool[CMD_TEXT_POOL];
+    //! ASCII parser: number of used characters of textPool
+    int textUsed;
+    
+    void clear(command& cmd);
+    int checkInt(const commandField& field, int value);
+    int checkSubcommand(const commandSpec& spec, char subcommand);
+    void beginField();
+    void endField();
+    void fail(int error);
+    void readFieldChar(char c, command& cmd);
+};
+
+#endif
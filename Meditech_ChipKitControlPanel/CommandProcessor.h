@@ -11,10 +11,13 @@
 #ifndef __COMMANDPROCESSOR_H__
 #define __COMMANDPROCESSOR_H__
 
-//! The max len of an unparsed command string
-#define MAX_CMD_LEN 1024
+#include "Globals.h"
+#include "FixedString.h"
+
 //! The max len of the message command string
 #define CMD_MSGLEN 20
+//! The max len of the response message to the master
+#define CMD_RESPONSE_LEN 32
 //! The max len of a header/menu string
 #define CMD_HEADERLEN 14
 
@@ -41,6 +44,29 @@
 //! String delimiter
 #define STRING_DELIMITER '"'
 
+/**
+  \brief Sequence ID marker
+  
+  A command line can start with the sequence ID marker followed by the
+  PARM_SEQUENCE_LEN digits of the sequence ID. The board starts the responses
+  to the command line with the same sequence ID, so the master can match
+  every response with its request while more commands are waiting for
+  the response.
+  
+  Example: #07@L;00;... is acknowledged by #07:L:0
+  */
+#define SEQUENCE_MARKER '#'
+
+//! Fixed sequence ID characters lenght.
+//! Should be left zero filled in the form 00
+#define PARM_SEQUENCE_LEN 2
+
+//! Number of the sequence IDs (from 0 to MAX_SEQUENCE - 1)
+#define MAX_SEQUENCE 100
+
+//! Sequence ID of the commands sent without sequence ID
+#define NO_SEQUENCE -1
+
 //! Fixed field ID characters lenght.
 //! Should be left zero filled in the form 00
 #define PARM_FIELDID_LEN 2
@@ -67,6 +93,16 @@
 #define MAX_LONG 2
 //! Max number of float parameters in a command
 #define MAX_FLOAT 2
+//! Max number of string parameters in a command
+#define CMD_MAX_STRINGS 8
+
+#ifdef __STATIC_STRINGS
+//! The response message to the master, in a fixed-capacity buffer
+typedef FixedString<CMD_RESPONSE_LEN> responseString;
+#else
+//! The response message to the master, in a String growing on the heap
+typedef String responseString;
+#endif
 
 /** 
   \typedef command
@@ -82,15 +118,19 @@ typedef struct parseCommand {
   char subcommand[1];
   //! Command associated message string, used to return messages
    //! to the master and sending requests. The string should not be
-   //! longer than CMD_MSGLEN
-  String message;
+   //! longer than CMD_RESPONSE_LEN
+  responseString message;
   
-  //! The number of characters collected by the last lines read buffer
-  //! from serial
-  int commandLength;
+  //! The sequence ID of the command being parsed or NO_SEQUENCE. The
+  //! responses to the master start with the same sequence ID
+  int sequence;
   
-  //! Returning parameter from the command parser
-  String stringValue;
+  //! Returning parameter from the command parser. The strings point
+  //! inside the parsed command line (or the parser buffer for the binary
+  //! frames) and are valid until the next command is parsed
+  const char* stringValue[CMD_MAX_STRINGS];
+  //! Number of strings in stringValue
+  int numStrings;
   //! Returning parameter from the command parser
   //! The array number of position is the longer number of type parameters
   //! in a command
@@ -99,18 +139,17 @@ typedef struct parseCommand {
   //! The array number of position is the longer number of type parameters
   //! in a command
   int intValue[2];
+  //! Number of integers in intValue
+  int numInts;
   //! Returning parameter from the command parser
   //! The array number of position is the longer number of type parameters
   //! in a command
   float floatValue[2];
   //! Returning parameter from the command parser
-  float booleanValue;
+  bool booleanValue;
 
 } command;
 
-//! The lenght of CMD_CHARACTERS + 1
-#define CMD_CHARLEN 10
-
 /**
   \brief command: Enable/disable a probe
   
@@ -188,13 +227,49 @@ typedef struct parseCommand {
   */
 #define CMD_LCDTEMPLATE 'L'
 
+/**
+  \brief command: Update a field of the active LCD template
+  
+  description: replace the string of a single field of the template shown by the
+  last CMD_LCDTEMPLATE command. Only the field characters are redrawn: the display
+  is not cleared and the other fields are not sent again. The characters of the
+  previous string exceeding the new one are blanked.
+  name: F \n
+  usage: F;<Field ID>;"<Field String>" \n
+  direction: receive\n
+  example: F;02;"72" \n
+  Show 72 in the spot value field of the heartbeat template
+  
+  \note The command fails with COMMAND_WRONG_TEMPLATE if no template is shown
+  */
+#define CMD_FIELD 'F'
+
+/**
+  \brief command: binary link protocol request
+  
+  description: the master asks if the binary framed protocol (see LinkProtocol.h)
+  is supported. The board accepts the binary frames at any time, recognised by the
+  link delimiter, and answers every binary command with a binary response. The
+  master starts sending binary frames only after this command has been acknowledged
+  with no errors, so the boards not supporting the binary protocol keep working
+  with the ASCII commands.
+  name: B \n
+  usage: B;<(bool)enable> \n
+  direction: receive\n
+  example: B;1 \n
+  */
+#define CMD_BINARY 'B'
+
 /**
   \brief command: info
   
   description: shows the current health status parameters of the
   control panel (temperature, fan speed, active flags etc.)
+  The response includes the serial reception counters: the bytes lost
+  because the receive ring was full and the discarded binary frames.
   name: I \n
   usage: I \n
+  response: :I:<overruns>:<framing errors>:<result> \n
   direction: receive\n
   */
 #define CMD_INFO 'I'
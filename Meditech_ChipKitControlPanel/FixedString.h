@@ -0,0 +1,195 @@
+/**
+  \file FixedString.h
+  \brief Fixed-capacity string used instead of the Arduino String class
+
+  The Arduino String class grows its buffer on the heap every time a string
+  is concatenated. As the board has no MMU, after a long uptime the heap can
+  be so fragmented that an allocation fails. The FixedString class stores
+  the characters in a buffer of fixed capacity, allocated with the object, and
+  exposes the same methods used by the firmware (concat(), toCharArray()), so
+  it can replace a String declaration when __STATIC_STRINGS is defined (see
+  Globals.h). The characters exceeding the capacity are discarded.
+
+  The buffer capacities that depend on each other are verified when the
+  firmware is compiled with the STATIC_CHECK macro.
+  */
+
+#ifndef __FIXEDSTRING_H__
+#define __FIXEDSTRING_H__
+
+/**
+  \brief Compile-time check of a condition
+
+  If the condition is false the compilation fails with a negative array size
+  error on the typedef with the specified name.
+
+  \param condition The constant condition to check
+  \param name The name describing the check
+  */
+#define STATIC_CHECK(condition, name) typedef char name[(condition) ? 1 : -1]
+
+//! Number of decimals of the float values appended to a FixedString
+#define FIXEDSTRING_DECIMALS 2
+
+template <int N>
+class FixedString {
+  public:
+    /**
+      \brief Constructor method. Creates an empty string
+      */
+    FixedString() {
+      clear();
+    }
+
+    /**
+      \brief Replace the string content
+
+      \param value The null terminated string
+      */
+    FixedString& operator=(const char* value) {
+      clear();
+      concat(value);
+      return *this;
+    }
+
+    /**
+      \brief Return the null terminated string, e.g. to send it with the
+      streaming operators
+      */
+    operator const char*() const {
+      return text;
+    }
+
+    /**
+      \brief Empty the string
+      */
+    void clear() {
+      len = 0;
+      text[0] = '\0';
+    }
+
+    /**
+      \brief Append a null terminated string
+
+      \return false if the string has been truncated
+      */
+    bool concat(const char* value) {
+      while (*value != '\0') {
+        if (!concat(*value++))
+          return false;
+      }
+      return true;
+    }
+
+    /**
+      \brief Append a character
+
+      \return false if the string is full
+      */
+    bool concat(char value) {
+      if (len == N)
+        return false;
+      text[len++] = value;
+      text[len] = '\0';
+      return true;
+    }
+
+    /**
+      \brief Append an integer in decimal format
+
+      \return false if the string has been truncated
+      */
+    bool concat(int value) {
+      return concat((long)value);
+    }
+
+    /**
+      \brief Append a long integer in decimal format
+
+      \return false if the string has been truncated
+      */
+    bool concat(long value) {
+      //! The digits in reverse order
+      char digits[11];
+      int count = 0;
+      unsigned long absValue = value < 0 ? -(unsigned long)value : value;
+
+      do {
+        digits[count++] = '0' + absValue % 10;
+        absValue /= 10;
+      } while (absValue > 0);
+
+      if ( (value < 0) && !concat('-') )
+        return false;
+      while (count > 0) {
+        if (!concat(digits[--count]))
+          return false;
+      }
+      return true;
+    }
+
+    /**
+      \brief Append a float with FIXEDSTRING_DECIMALS decimals
+
+      \return false if the string has been truncated
+      */
+    bool concat(float value) {
+      long scale = 1;
+      long decimals;
+
+      for (int j = 0; j < FIXEDSTRING_DECIMALS; j++)
+        scale *= 10;
+
+      if ( (value < 0) && !concat('-') )
+        return false;
+      if (value < 0)
+        value = -value;
+
+      decimals = (long)((value - (long)value) * scale + 0.5);
+      if (decimals == scale) {
+        value += 1;
+        decimals = 0;
+      } // Rounded to the next integer
+
+      if (!concat((long)value) || !concat('.'))
+        return false;
+      for (scale /= 10; scale > 1; scale /= 10) {
+        if ( (decimals < scale) && !concat('0') )
+          return false;
+      } // Leading zeroes of the decimals
+      return concat(decimals);
+    }
+
+    /**
+      \brief Copy the string in a character buffer
+
+      \param buffer The destination buffer
+      \param size The buffer size, including the string terminator
+      */
+    void toCharArray(char* buffer, int size) const {
+      int j;
+
+      if (size <= 0)
+        return;
+      for (j = 0; (j < len) && (j < size - 1); j++)
+        buffer[j] = text[j];
+      buffer[j] = '\0';
+    }
+
+    /**
+      \brief Return the number of characters
+      */
+    int length() const {
+      return len;
+    }
+
+  private:
+    STATIC_CHECK(N > 0, fixedStringCapacity);
+
+    //! The characters and the string terminator
+    char text[N + 1];
+    //! Number of characters
+    int len;
+};
+
+#endif
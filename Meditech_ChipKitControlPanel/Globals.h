@@ -56,10 +56,23 @@
 //! The serial communication speed with the RPI master
 #define SERIAL_SPEED 38400
 
+//! Serial reception interrupt frequency (1 ms). The serial port buffer
+//! receives less than 4 bytes per ms at SERIAL_SPEED
+#define SERIAL_RECEIVE_TIMEOUT 1
+
 
 //! Update the display task every second (in ms)
 #define TASK_UPDATEDISPLAY  1000 
 
+//! Build without the Arduino String class: the strings use fixed-capacity
+//! buffers (see FixedString.h), so the firmware never allocates on the heap.
+//! Undef to use the String class
+#define __STATIC_STRINGS
+
+//! Send the report of the statically allocated RAM on the serial port at
+//! startup. Define to enable the report
+#undef __RAM_REPORT
+
 #endif
 
 
@@ -23,6 +23,9 @@
 #define LCDTOPROW 0
 //! The bottom row number of the LCD
 #define LCDBOTTOMROW 1
+//! The column of the internal temperature, shown on the top row with every
+//! template
+#define LCDTEMPCOL 14
 
 //! Delay after showing an error
 #define LCDERROR_DELAY 5000
@@ -50,10 +53,10 @@ public:
 	~LCD();
 	void enable(bool s);				///< Set the display on or off
 	void blink(bool set);				///< Set blink mode
-	void error(String m);				///< shows an error message
-	void error(String m, int x, int y);		///< shows an error message at specified coordinates
-	void message(String m);				///< shows a string message
-	void message(String m, int x, int y);		///< shows a string message at specified coordinates
+	void error(const char* m);			///< shows an error message
+	void error(const char* m, int x, int y);	///< shows an error message at specified coordinates
+	void message(const char* m);			///< shows a string message
+	void message(const char* m, int x, int y);	///< shows a string message at specified coordinates
 	void clean();								///< clean the LCD screen
 	void dec(int n);							///< shows an integer in decimal format
 	void hex(int n);							///< shows an integer in hexadeciaml format
@@ -0,0 +1,214 @@
+/**
+  \file LCDBuffer.cpp
+  \brief LCDBuffer class buffers the LCD writes and sends only the changed
+  characters to the display.
+  */
+
+#include "LCDBuffer.h"
+#include "FixedString.h"
+#include <string.h>
+
+/**
+  \brief Class constructor
+  
+  The LCD is expected to be cleared, as after lcd.begin().
+  
+  \param display The LCD hardware
+  */
+LCDBuffer::LCDBuffer(AlphaLCD& display) : lcd(display) {
+  overlayText = NULL;
+  reset();
+}
+
+/**
+  \brief Clear the display content and move the cursor to the top left
+  corner
+  
+  Only the shadow is cleared: the LCD clear command and its delay are never
+  used, flush() rewrites the cells not already empty.
+  */
+void LCDBuffer::clear() {
+  for (int row = 0; row < LCDROWS; row++) {
+    for (int col = 0; col < LCDCHARS; col++)
+      shadow[row][col] = ' ';
+  }
+  cursorCol = 0;
+  cursorRow = 0;
+  isDirty = true;
+}
+
+/**
+  \brief Move the write cursor
+  
+  \param col The column, zero based
+  \param row The row, zero based
+  */
+void LCDBuffer::setCursor(int col, int row) {
+  cursorCol = col < 0 ? 0 : (col > LCDCHARS ? LCDCHARS : col);
+  cursorRow = row < 0 ? 0 : (row >= LCDROWS ? LCDROWS - 1 : row);
+}
+
+/**
+  \brief Write a string at the cursor position
+  
+  As on the LCD, the characters beyond the last column are not visible, so
+  they are discarded.
+  
+  \param text The null terminated string
+  */
+void LCDBuffer::print(const char* text) {
+  while (*text != '\0')
+    print(*text++);
+}
+
+/**
+  \brief Write a character at the cursor position and advance the cursor
+  
+  \param value The character
+  */
+void LCDBuffer::print(char value) {
+  if (cursorCol >= LCDCHARS)
+    return;
+
+  if (shadow[cursorRow][cursorCol] != value) {
+    shadow[cursorRow][cursorCol] = value;
+    isDirty = true;
+  } // Changed cell
+  cursorCol++;
+}
+
+/**
+  \brief Write a float with two decimals at the cursor position
+  
+  \param value The float value
+  */
+void LCDBuffer::print(float value) {
+  FixedString<LCDCHARS> text;
+
+  text.concat(value);
+  print((const char*)text);
+}
+
+/**
+  \brief Write a string at the cursor position, with the streaming syntax
+  */
+LCDBuffer& LCDBuffer::operator<<(const char* text) {
+  print(text);
+  return *this;
+}
+
+/**
+  \brief Write a float at the cursor position, with the streaming syntax
+  */
+LCDBuffer& LCDBuffer::operator<<(float value) {
+  print(value);
+  return *this;
+}
+
+/**
+  \brief Send the changed cells to the LCD
+  
+  The cells are sent row by row, with the overlay if it is set. The LCD cursor advances after every
+  character, so the cursor is moved only at the start of a sequence of
+  changed cells; the unchanged cells in a gap up to LCD_BRIDGE_GAP long are
+  rewritten instead.
+  
+  \return The number of characters sent to the LCD
+  */
+int LCDBuffer::flush() {
+  int written = 0;
+  //! The LCD cursor column in the current row or -1 if not known
+  int lcdCol;
+  char cell;
+
+  if (!isDirty)
+    return 0;
+
+  for (int row = 0; row < LCDROWS; row++) {
+    lcdCol = -1;
+    for (int col = 0; col < LCDCHARS; col++) {
+      cell = getCell(row, col);
+      if (cell == screen[row][col])
+        continue;
+
+      if ( (lcdCol >= 0) && (col - lcdCol <= LCD_BRIDGE_GAP) ) {
+        for (; lcdCol < col; lcdCol++, written++)
+          lcd.print(screen[row][lcdCol]);
+      } // Rewrite the short gap
+      else if (lcdCol != col)
+        lcd.setCursor(col, row);
+
+      lcd.print(cell);
+      screen[row][col] = cell;
+      lcdCol = col + 1;
+      written++;
+    } // Row cells
+  } // Rows
+
+  isDirty = false;
+
+  return written;
+}
+
+/**
+  \brief Synchronise the buffer with an LCD just cleared
+  
+  Should be called after the LCD has been cleared directly with the hardware
+  clear command.
+  */
+void LCDBuffer::reset() {
+  clear();
+  for (int row = 0; row < LCDROWS; row++) {
+    for (int col = 0; col < LCDCHARS; col++)
+      screen[row][col] = ' ';
+  }
+  isDirty = false;
+}
+
+/**
+  \brief Show a text on an empty display, over the buffer content
+  
+  The display writes still change the buffer content, that is shown again
+  by hideOverlay().
+  
+  \param text The overlay text, a string constant
+  \param col The column, zero based
+  \param row The row, zero based
+  */
+void LCDBuffer::showOverlay(const char* text, int col, int row) {
+  if ( (overlayText == text) && (overlayCol == col) && (overlayRow == row) )
+    return;
+
+  overlayText = text;
+  overlayLength = strlen(text);
+  overlayCol = col;
+  overlayRow = row;
+  isDirty = true;
+}
+
+/**
+  \brief Remove the overlay, so the buffer content is shown again
+  */
+void LCDBuffer::hideOverlay() {
+  if (overlayText == NULL)
+    return;
+
+  overlayText = NULL;
+  isDirty = true;
+}
+
+/**
+  \brief Return the character shown in a cell, with the overlay if it is set
+  
+  \param row The row, zero based
+  \param col The column, zero based
+  */
+char LCDBuffer::getCell(int row, int col) {
+  if (overlayText == NULL)
+    return shadow[row][col];
+
+  if ( (row == overlayRow) && (col >= overlayCol) && (col < overlayCol + overlayLength) )
+    return overlayText[col - overlayCol];
+
+  return ' ';
+}
@@ -0,0 +1,69 @@
+/**
+  \file LCDBuffer.h
+  \brief Shadow buffer of the LCD display content
+  
+  The LCD is driven through a shift register, so every character and every
+  command sent to the display is bit-banged and it is the slowest operation
+  of the board. The LCDBuffer class keeps in RAM a copy of the content to show
+  (the shadow) and a copy of the content actually shown by the LCD (the
+  screen). All the display writes change the shadow only; flush() sends to
+  the LCD only the cells that differ from the screen, moving the cursor only
+  when the next changed cell is not the next character position. Writing the
+  same content again, e.g. the temperature not changed, or clearing the
+  display before drawing a template, costs nothing on the LCD.
+  
+  An alarm (e.g. the lid open message) is shown as an overlay: while it is
+  set, flush() shows the overlay text on an empty display, but the writes
+  still change the shadow. When the overlay is removed the shadow content,
+  including the fields changed in the meantime, is shown again.
+  */
+
+#ifndef __LCDBUFFER_H__
+#define __LCDBUFFER_H__
+
+#include "LCD.h"
+
+//! Max number of unchanged cells rewritten between two changed cells of a
+//! row instead of moving the cursor. A cursor move costs as a character
+#define LCD_BRIDGE_GAP 1
+
+class LCDBuffer {
+  public:
+    LCDBuffer(AlphaLCD& display);
+    void clear();
+    void setCursor(int col, int row);
+    void print(const char* text);
+    void print(char value);
+    void print(float value);
+    LCDBuffer& operator<<(const char* text);
+    LCDBuffer& operator<<(float value);
+    int flush();
+    void reset();
+    void showOverlay(const char* text, int col, int row);
+    void hideOverlay();
+  private:
+    //! The LCD hardware
+    AlphaLCD& lcd;
+    //! The content to show
+    char shadow[LCDROWS][LCDCHARS];
+    //! The content shown by the LCD
+    char screen[LCDROWS][LCDCHARS];
+    //! Write cursor column in the shadow
+    uint8_t cursorCol;
+    //! Write cursor row in the shadow
+    uint8_t cursorRow;
+    //! True if the shadow has been written after the last flush
+    bool isDirty;
+    //! The overlay text or NULL if no overlay is shown
+    const char* overlayText;
+    //! The overlay text length
+    uint8_t overlayLength;
+    //! The overlay column
+    uint8_t overlayCol;
+    //! The overlay row
+    uint8_t overlayRow;
+    
+    char getCell(int row, int col);
+};
+
+#endif
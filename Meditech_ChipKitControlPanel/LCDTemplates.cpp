@@ -6,118 +6,96 @@
 
 #include "LCD.h"
 #include "LCDTemplates.h"
+#include "FixedString.h"
+#include <stddef.h>
+
+//! TID_INFO field positions, checked against the field widths
+#define INFO_TITLE_CELL LAYOUT_CELL(0, 0)
+#define INFO_RPM_CELL LAYOUT_CELL(1, 16)
+#define INFO_DATE_CELL LAYOUT_CELL(0, 5)
+#define INFO_TIME_CELL LAYOUT_CELL(1, 10)
+#define INFO_GPS_CELL LAYOUT_CELL(1, 0)
+
+//! True if a field of the width ends at least a blank before the next field
+//! of the same row
+#define FIELD_CLEAR(cell, width, next) ( (LAYOUT_ROW(cell) == LAYOUT_ROW(next)) && \
+  (LAYOUT_COL(cell) + (width) < LAYOUT_COL(next)) )
+
+//! The templates layouts, in template ID order. The fields are in the order
+//! they are sent by the master
+static const templateLayout layoutsTable[] = {
+  // TID_STETHOSCOPE: title, gain, gain value
+  { STETHOSCOPE_FIELDS, { LAYOUT_CELL(0, 0), LAYOUT_CELL(1, 0), LAYOUT_CELL(1, 6) } },
+  // TID_BLOODPRESS: title, wait, min, min value, max, max value
+  { BLOODPRESS_FIELDS, { LAYOUT_CELL(0, 0), LAYOUT_CELL(1, 16), LAYOUT_CELL(1, 0),
+      LAYOUT_CELL(1, 4), LAYOUT_CELL(1, 8), LAYOUT_CELL(1, 11) } },
+  // TID_HEARTBEAT: title, spot, spot value, average, average value
+  { HEARTBEAT_FIELDS, { LAYOUT_CELL(0, 0), LAYOUT_CELL(1, 0), LAYOUT_CELL(1, 5),
+      LAYOUT_CELL(1, 10), LAYOUT_CELL(1, 15) } },
+  // TID_TEMPERATURE: title, spot, spot value, average, average value
+  { TEMPERATURE_FIELDS, { LAYOUT_CELL(0, 0), LAYOUT_CELL(1, 0), LAYOUT_CELL(1, 5),
+      LAYOUT_CELL(1, 11), LAYOUT_CELL(1, 16) } },
+  // TID_ECG: title, status, status flag
+  { ECG_FIELDS, { LAYOUT_CELL(0, 0), LAYOUT_CELL(1, 0), LAYOUT_CELL(1, 7) } },
+  // TID_TEST: title, status
+  { TEST_FIELDS, { LAYOUT_CELL(0, 0), LAYOUT_CELL(1, 0) } },
+  // TID_INFO: title, rpm, date, time, gps
+  { INFO_FIELDS, { INFO_TITLE_CELL, INFO_RPM_CELL, INFO_DATE_CELL,
+      INFO_TIME_CELL, INFO_GPS_CELL } },
+  // TID_DEFAULT: title, version, status
+  { DEFAULT_FIELDS, { LAYOUT_CELL(0, 0), LAYOUT_CELL(1, 0), LAYOUT_CELL(1, 10) } }
+};
+
+STATIC_CHECK(sizeof(layoutsTable) / sizeof(templateLayout) == MAX_TEMPLATES, checkTemplatesCount);
+STATIC_CHECK(TID_DEFAULT == MAX_TEMPLATES - 1, checkDefaultID);
+STATIC_CHECK(LCDCHARS <= LAYOUT_COL(0xFF) + 1, checkColumnBits);
+STATIC_CHECK(LCDROWS <= LAYOUT_ROW(0xFF) + 1, checkRowBits);
+STATIC_CHECK(
+  (STETHOSCOPE_FIELDS <= MAX_FIELDS) &&
+  (BLOODPRESS_FIELDS <= MAX_FIELDS) &&
+  (HEARTBEAT_FIELDS <= MAX_FIELDS) &&
+  (TEMPERATURE_FIELDS <= MAX_FIELDS) &&
+  (ECG_FIELDS <= MAX_FIELDS) &&
+  (TEST_FIELDS <= MAX_FIELDS) &&
+  (INFO_FIELDS <= MAX_FIELDS) &&
+  (DEFAULT_FIELDS <= MAX_FIELDS), checkFieldsCount);
+STATIC_CHECK(
+  FIELD_CLEAR(INFO_TITLE_CELL, INFO_TITLE_LEN, INFO_DATE_CELL) &&
+  FIELD_CLEAR(INFO_DATE_CELL, INFO_DATE_LEN, LAYOUT_CELL(LCDTOPROW, LCDTEMPCOL)) &&
+  FIELD_CLEAR(INFO_GPS_CELL, INFO_GPS_LEN, INFO_TIME_CELL) &&
+  FIELD_CLEAR(INFO_TIME_CELL, INFO_TIME_LEN, INFO_RPM_CELL) &&
+  (LAYOUT_COL(INFO_RPM_CELL) + INFO_RPM_LEN <= LCDCHARS), checkInfoFieldsClear);
 
 /**
   \brief Class constructor
   
+  \param myLCD The display buffer the templates are drawn in
   */
-LCDTemplates::LCDTemplates(AlphaLCD myLCD) {
-  mLcd = myLCD;
+LCDTemplates::LCDTemplates(LCDBuffer& myLCD) : mLcd(myLCD) {
+  id = -1;
+  layout = NULL;
 }
 
 /**
-  \brief Create the full display view parameters.
+  \brief Select the layout of the template.
   
   This method should be called only when the template ID
   has already been set.
   
-  \return The number of fields of the selected template
+  \return The number of fields of the selected template or 0 if
+  the template ID is not valid
   */
 int LCDTemplates::createDisplay() {
-  int numFields;
-
-  switch(id) {
-    case TID_STETHOSCOPE:
-      fields.row[STET_TITLE] = 0;
-      fields.col[STET_TITLE] = 0;
-      fields.row[STET_GAIN] = 1;
-      fields.col[STET_GAIN] = 0;
-      fields.row[STET_GAINVAL] = 1;
-      fields.col[STET_GAINVAL] = 6;
-      numFields = STETHOSCOPE_FIELDS;
-    break;
-    case TID_BLOODPRESS:
-      fields.row[BLOOD_TITLE] = 0;
-      fields.col[BLOOD_TITLE] = 0;
-      fields.row[BLOOD_WAIT] = 1;
-      fields.col[BLOOD_WAIT] = 16;
-      fields.row[BLOOD_MIN] = 1;
-      fields.col[BLOOD_MIN] = 0;
-      fields.row[BLOOD_MINVAL] = 1;
-      fields.col[BLOOD_MINVAL] = 4;
-      fields.row[BLOOD_MAX] = 1;
-      fields.col[BLOOD_MAX] = 8;
-      fields.row[BLOOD_MAXVAL] = 1;
-      fields.col[BLOOD_MAXVAL] = 11;
-      numFields = BLOODPRESS_FIELDS;
-    break;
-    case TID_HEARTBEAT:
-      fields.row[HEARTBEAT_TITLE] = 0;
-      fields.col[HEARTBEAT_TITLE] = 0;
-      fields.row[HEARTBEAT_SPOT] = 1;
-      fields.col[HEARTBEAT_SPOT] = 0;
-      fields.row[HEARTBEAT_SPOTVAL] = 1;
-      fields.col[HEARTBEAT_SPOTVAL] = 5;
-      fields.row[HEARTBEAT_AVERAGE] = 1;
-      fields.col[HEARTBEAT_AVERAGE] = 10;
-      fields.row[HEARTBEAT_AVERAGEVAL] = 1;
-      fields.col[HEARTBEAT_AVERAGEVAL] = 15;
-      numFields = HEARTBEAT_FIELDS;
-    break;
-    case TID_TEMPERATURE:
-      fields.row[TEMPERATURE_TITLE] = 0;
-      fields.col[TEMPERATURE_TITLE] = 0;
-      fields.row[TEMPERATURE_SPOT] = 1;
-      fields.col[TEMPERATURE_SPOT] = 0;
-      fields.row[TEMPERATURE_SPOTVAL] = 1;
-      fields.col[TEMPERATURE_SPOTVAL] = 5;
-      fields.row[TEMPERATURE_AVERAGE] = 1;
-      fields.col[TEMPERATURE_AVERAGE] = 11;
-      fields.row[TEMPERATURE_AVERAGEVAL] = 1;
-      fields.col[TEMPERATURE_AVERAGEVAL] = 16;
-      numFields = TEMPERATURE_FIELDS;
-    break;
-    case TID_ECG:
-      fields.row[ECG_TITLE] = 0;
-      fields.col[ECG_TITLE] = 0;
-      fields.row[ECG_STATUS] = 1;
-      fields.col[ECG_STATUS] = 0;
-      fields.row[ECG_STATUSFLAG] = 1;
-      fields.col[ECG_STATUSFLAG] = 7;
-      numFields = ECG_FIELDS;
-    break;
-    case TID_TEST:
-      fields.row[TEST_TITLE] = 0;
-      fields.col[TEST_TITLE] = 0;
-      fields.row[TEST_STATUS] = 1;
-      fields.col[TEST_STATUS] = 0;
-      numFields = TEST_FIELDS;
-    break;
-    case TID_INFO:
-      fields.row[INFO_TITLE] = 0;
-      fields.col[INFO_TITLE] = 0;
-      fields.row[INFO_RPM] = 1;
-      fields.col[INFO_RPM] = 16;
-      fields.row[INFO_DATE] = 0;
-      fields.col[INFO_DATE] = 4;
-      fields.row[INFO_TIME] = 0;
-      fields.col[INFO_TIME] = 9;
-      fields.row[INFO_GPS] = 1;
-      fields.col[INFO_GPS] = 0;
-      numFields = INFO_FIELDS;
-    break;
-    case TID_DEFAULT:
-      fields.row[DEFAULT_TITLE] = 0;
-      fields.col[DEFAULT_TITLE] = 0;
-      fields.row[DEFAULT_VERSION] = 1;
-      fields.col[DEFAULT_VERSION] = 0;
-      fields.row[DEFAULT_STATUS] = 1;
-      fields.col[DEFAULT_STATUS] = 10;
-      numFields = DEFAULT_FIELDS;
-    break;
-  }  
-  
-  return numFields;
+  if ( (id < 0) || (id >= MAX_TEMPLATES) ) {
+    layout = NULL;
+    return 0;
+  } // Invalid template ID
+
+  layout = &layoutsTable[id];
+  for (int j = 0; j < MAX_FIELDS; j++)
+    fieldLength[j] = 0;
+
+  return layout->numFields;
 }
 
 /**
@@ -129,17 +107,45 @@ int LCDTemplates::createDisplay() {
   should be called.
   When the method is called, the class field value is updated after
   the value conversion.
+  The characters of the previous field string exceeding the new string are
+  replaced with spaces, so a field can be updated without redrawing the
+  whole template.
   
   \param val The string to update
   \param field The field ID
   */
-void LCDTemplates::updateDisplay(String val, int fieldID) {
-  mLcd.setCursor(fields.col[fieldID], fields.row[fieldID]);
-  mLcd << val;
+void LCDTemplates::updateDisplay(const char* val, int fieldID) {
+  int length = 0;
+
+  if ( (layout == NULL) || (fieldID < 0) || (fieldID >= layout->numFields) )
+    return;
+
+  mLcd.setCursor(LAYOUT_COL(layout->cells[fieldID]), LAYOUT_ROW(layout->cells[fieldID]));
+  while ( (val[length] != '\0') && (length < LCDCHARS) )
+    mLcd.print(val[length++]);
+  for (int j = length; j < fieldLength[fieldID]; j++)
+    mLcd.print(' ');
+  fieldLength[fieldID] = length;
+}
+
+/**
+  \brief Return the number of fields of a template
+  
+  \param templateID The template ID
+  \return The number of fields or 0 if the template ID is not valid
+  */
+int LCDTemplates::getNumFields(int templateID) {
+  if ( (templateID < 0) || (templateID >= MAX_TEMPLATES) )
+    return 0;
+
+  return layoutsTable[templateID].numFields;
 }
 
 /**
   \brief Clean che LCD display area
+  
+  Only the display buffer is cleared, so the characters drawn again at the
+  same position are not sent to the LCD.
   */
 void LCDTemplates::cleanDisplay() {
   mLcd.clear();
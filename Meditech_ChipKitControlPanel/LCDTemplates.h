@@ -17,13 +17,16 @@
   <b> the template is filled at runtime</b>\n
   
   Every template is an array of a set of basic <b>fields</b> defining the parameters where a certain value should
-  be shown. 
+  be shown. The layouts of all the templates are stored in a constant table, in template ID order, so they are
+  kept in flash and a template is selected without any computation. Every field position is packed in a single
+  byte: the row in the three high bits and the column in the five low bits (see LAYOUT_CELL).
   */
 
 #ifndef __LCDTEMPLATES_H__
 #define __LCDTEMPLATES_H__
 
 #include "LCD.h"
+#include "LCDBuffer.h"
 
 /**
   \brief Defines the active probe bit
@@ -60,22 +63,30 @@ typedef word probeActive;
 //! E.C.G. enabled bit
 #define ECG_ON 0x0010
 
-//! Max number of templates
-#define MAX_TEMPLATES 7
+//! Max number of templates, including the default template.
+//! The template IDs are from 0 to MAX_TEMPLATES - 1
+#define MAX_TEMPLATES 8
 
 //! Largest field array. Corresonds to the largest
 //! possible template
-#define MAX_FIELDS 6;
+#define MAX_FIELDS 6
+
+//! Pack a field position in a byte
+#define LAYOUT_CELL(row, col) (uint8_t)(((row) << 5) | (col))
+//! The row of a packed field position
+#define LAYOUT_ROW(cell) ((cell) >> 5)
+//! The column of a packed field position
+#define LAYOUT_COL(cell) ((cell) & 0x1F)
 
 /**
-  \brief LCD template field type definition
+  \brief LCD template layout type definition
   
-  Defines a generic LCD display field
+  Defines the position of every field of a template
   */
-typedef struct LCDTemplateField {
-  int row[6];       ///< Field row
-  int col[6];       ///< Field column
-} field;
+typedef struct LCDTemplateLayout {
+  uint8_t numFields;            ///< Number of fields
+  uint8_t cells[MAX_FIELDS];    ///< Packed field positions (see LAYOUT_CELL)
+} templateLayout;
 
 //! Microphonic stethoscope template
 #define TID_STETHOSCOPE 0
@@ -133,6 +144,13 @@ typedef struct LCDTemplateField {
 #define INFO_DATE 2
 #define INFO_TIME 3
 #define INFO_GPS 4
+//! Max width of the info template fields. The date ("%d/%m") and the time
+//! ("%H:%M") are sent by the master clock
+#define INFO_TITLE_LEN 4
+#define INFO_RPM_LEN 4
+#define INFO_DATE_LEN 5
+#define INFO_TIME_LEN 5
+#define INFO_GPS_LEN 9
 
 //! Control panel default template
 #define TID_DEFAULT 7
@@ -143,14 +161,19 @@ typedef struct LCDTemplateField {
 
 class LCDTemplates {
   public:
-    LCDTemplates(AlphaLCD myLCD);
+    LCDTemplates(LCDBuffer& myLCD);
     int createDisplay();
-    void updateDisplay(String val, int fieldID);
+    void updateDisplay(const char* val, int fieldID);
     void cleanDisplay();
+    static int getNumFields(int templateID);
     int id;
-    LCDTemplateField fields;
   private:
-    AlphaLCD mLcd;
+    LCDBuffer& mLcd;
+    //! The layout of the template or NULL if the ID is not valid
+    const templateLayout* layout;
+    //! The number of characters drawn in every field, blanked when the
+    //! field is updated with a shorter string
+    uint8_t fieldLength[MAX_FIELDS];
 };
 
 #endif
@@ -0,0 +1,101 @@
+/**
+\file LinkProtocol.h
+\brief Binary framed link protocol between the master and the control panel board.
+
+ The binary protocol is an alternative to the ASCII '@' command strings. Every
+ frame is a payload of typed fields protected by a CRC-16 and encoded with the
+ COBS (Consistent Overhead Byte Stuffing) algorithm, so the LINK_DELIMITER byte
+ never appears inside the encoded frame. The frame is sent between two delimiters:
+
+ <LINK_DELIMITER><COBS encoded payload + CRC><LINK_DELIMITER>
+
+ The ASCII commands never include the delimiter so the receiver recognises the
+ binary frames at any time. The payload starts with the command character (the
+ same used by the ASCII protocol) and the sequence ID, followed by the typed fields. Every field starts
+ with its type code followed by the value: integers are big-endian, floats are
+ sent as the big-endian IEEE 754 bits and strings are prefixed by their length.
+
+ \warning This file should be identical to the corresponding file of the control
+ panel firmware.
+ */
+
+#include <stdint.h>
+
+#ifndef LINKPROTOCOL_H
+#define	LINKPROTOCOL_H
+
+//! Binary frames delimiter
+#define LINK_DELIMITER 0x00
+
+//! Max length of a frame payload, including the CRC
+#define LINK_MAX_PAYLOAD 192
+
+//! Max length of an encoded frame including the COBS overhead and the two delimiters
+#define LINK_MAX_FRAME (LINK_MAX_PAYLOAD + (LINK_MAX_PAYLOAD / 254) + 3)
+
+//! CRC length in bytes
+#define LINK_CRC_LEN 2
+
+//! Frame header length: the frame type and the sequence ID
+#define LINK_HEADER_LEN 2
+
+//! Sequence ID of the frames not related to a master request
+#define LINK_NO_SEQUENCE 0xFF
+
+//! Max length of a string field in a frame with no other fields
+#define LINK_MAX_STRING (LINK_MAX_PAYLOAD - LINK_CRC_LEN - LINK_HEADER_LEN - 2)
+
+//! Field type: unsigned 8 bits integer
+#define LINK_FIELD_UINT8 'c'
+//! Field type: signed 16 bits integer
+#define LINK_FIELD_INT16 'i'
+//! Field type: signed 32 bits integer
+#define LINK_FIELD_INT32 'l'
+//! Field type: 32 bits float
+#define LINK_FIELD_FLOAT 'f'
+//! Field type: boolean (one byte, 0 or 1)
+#define LINK_FIELD_BOOL 'b'
+//! Field type: string, one byte length followed by the characters
+#define LINK_FIELD_STRING 's'
+
+//! Frame type of the responses. The response is a string field
+//! with the same content of the ASCII response.
+#define LINK_RESPONSE ':'
+
+class LinkFrame {
+public:
+	LinkFrame();
+	void begin(char type, uint8_t sequence = LINK_NO_SEQUENCE);
+	bool addUInt8(uint8_t value);
+	bool addInt16(int16_t value);
+	bool addInt32(int32_t value);
+	bool addFloat(float value);
+	bool addBool(bool value);
+	bool addString(const char* value);
+	int encode(uint8_t* buffer, int bufferLength);
+	bool decode(const uint8_t* buffer, int bufferLength);
+	char getType();
+	uint8_t getSequence();
+	void setSequence(uint8_t sequence);
+	bool readUInt8(uint8_t& value);
+	bool readInt16(int16_t& value);
+	bool readInt32(int32_t& value);
+	bool readFloat(float& value);
+	bool readBool(bool& value);
+	bool readString(char* value, int maxLength);
+	bool isEnd();
+
+	static uint16_t crc16(const uint8_t* data, int length);
+private:
+	//! The frame payload
+	uint8_t payload[LINK_MAX_PAYLOAD];
+	//! Number of bytes in the payload, excluding the CRC
+	int length;
+	//! Position of the next field to read
+	int readPos;
+
+	bool addBytes(char type, const uint8_t* bytes, int count);
+	bool readBytes(char type, uint8_t* bytes, int count);
+};
+
+#endif	/* LINKPROTOCOL_H */
@@ -41,13 +41,24 @@
 #include "Temperature.h"
 #include <SoftPWMServo.h>
 #include "LCDTemplates.h"
+#include "LCDBuffer.h"
 #include "DebugStrings.h"
 #include "CommandProcessor.h"
 #include "ParserErrors.h"
+#include "LinkProtocol.h"
+#include "CommandParser.h"
+#include "RxRing.h"
 
 //! Display class instance
 AlphaLCD lcd(LCDdataPin, LCDclockPin, LCDlatchPin);
 
+//! Display content buffer. All the display writes go to the buffer and
+//! only the changed characters are sent to the LCD by lcdBuffer.flush()
+LCDBuffer lcdBuffer(lcd);
+
+//! The template shown on the display, updated field by field by the CMD_FIELD command
+LCDTemplates activeTemplate(lcdBuffer);
+
 //! Internal temperature sensor class instance
 Temperature internalTemp;
 
@@ -65,17 +76,17 @@ int updateDispalyTaskID;
 //! Parser command structure
 command cmd;
 
-  /**
-    \brief Unparsed Command String
-  
-    cmdData is the string after syntax checking.
-    The string can contain one or more commands.
-    When the command string is sent to the parser this value contains
-    the command sequence. When the this string is empy
-    all the commands has been processed and the system is ready to receive
-    a new command.
-  */
-  static char cmdData[MAX_CMD_LEN];
+//! The bytes received from the master, filled by the serialReceive() interrupt service
+RxRing rxRing;
+
+//! The COBS encoded bytes of the binary frame being received
+uint8_t linkData[LINK_MAX_FRAME];
+
+//! True while the bytes of a binary frame are received (after the opening delimiter)
+boolean isBinaryFrame = false;
+
+//! When true the master is acknowledged with a binary response frame
+boolean binaryResponse = false;
   
 /** 
   \brief Initialisation method
@@ -124,11 +135,18 @@ void setup() {
   attachCoreTimerService(isLidStatusChanged);
   // Set and start the timer for fan cooler speed regulation
   attachCoreTimerService(fanSpeedRegulation);
+  // Set and start the timer moving the received bytes in the ring
+  attachCoreTimerService(serialReceive);
   
   // Create the display update task.
   // This task updates automatically only the reserved display
   // areas, i.e. the temperature monitor and other information.
   updateDispalyTaskID = createTask(updateDisplay, TASK_UPDATEDISPLAY, TASK_ENABLE, NULL);
+  lcdBuffer.flush();
+
+#ifdef __RAM_REPORT
+  ramReport();
+#endif
 }
 
 /** 
@@ -138,19 +156,24 @@ void setup() {
   a high priority alarm. Also the internal temperature is checked periodically
   to set the fan speed to the correct value.\n
   When serial data are present (a command waiting from the PI main) the data are
-  parsed as needed.
+  parsed as needed, also while the lid open alarm is shown. The alarm is an
+  overlay of the display buffer, so the commands still update the active
+  template, that is shown again when the lid is closed.
   */
 void loop(void) {
 
+  // The commands are processed with the lid open too, so the master
+  // is always acknowledged
+  checkSerial();
+
   // Check if the lid is open
-  if(lidStatus == LIDCLOSED) {
-    checkSerial();
-  }
-  else {
-    // Show the error message
-    lcd.clear();
-    message(_LID_OPEN, 5, LCDTOPROW);
-  }
+  if(lidStatus == LIDOPEN)
+    lcdBuffer.showOverlay(_LID_OPEN, 5, LCDTOPROW);
+  else
+    lcdBuffer.hideOverlay();
+  
+  // Show the display changes of the commands and of the tasks
+  lcdBuffer.flush();
 }
 
 // -------- Control functions
@@ -165,21 +188,41 @@ void updateDisplay(int id, void * tptr) {
 /**
   \brief Control the presence of data from the serial interface. 
   
-  When data are detected on the serial buffer the parser function is 
-  launched to process the command.
+  All the bytes waiting in the receive ring are processed: the ASCII
+  characters are sent to the parser, that executes the commands as soon as
+  they end. The binary frames start with the LINK_DELIMITER character, that
+  never appears in the ASCII commands, so both the protocols are accepted at
+  any time.
   */
 void checkSerial() {
-  int nChar;
+  int readch;
+  int frameLength;
   
-  cmd.commandLength = readline(Serial1.read(), cmdData, MAX_CMD_LEN);
+  while ( (readch = rxRing.get()) >= 0) {
+    if( (readch == LINK_DELIMITER) || isBinaryFrame ) {
+      frameLength = readFrame(readch, linkData, LINK_MAX_FRAME);
+      if (frameLength > 0)
+        binaryParser(frameLength);
+    } // Binary frame
+    else if (readch > 0)
+      parser(readch);
+  } // Received bytes
+}
+
+/**
+  \brief Callback function from the serial reception interrupt
   
-  // If the line ends the program launch the parser.
-  if (cmd.commandLength > 0) {
-    #ifdef __DEBUG
-    Serial1 << "Received: >" << cmdData << "<" << endl;
-    #endif
-    parser(); // parse the command
-  }
+  Moves the bytes received by the serial port in the receive ring, so they
+  are not lost while loop() is busy. The service runs every
+  SERIAL_RECEIVE_TIMEOUT ms, before the serial port buffer is full.
+  */
+uint32_t serialReceive(uint32_t currentTime) {
+  
+  while (Serial1.available() > 0)
+    rxRing.put(Serial1.read());
+  
+  // Restart the timer
+  return (currentTime + CORE_TICK_RATE * SERIAL_RECEIVE_TIMEOUT);
 }
 
 /**
@@ -199,8 +242,8 @@ void tempMonitor() {
  */
 void showTemp() {
 
-  lcd.setCursor(14, LCDTOPROW);
-  lcd << internalTemp.Celsius() << _CELSIUS;
+  lcdBuffer.setCursor(LCDTEMPCOL, LCDTOPROW);
+  lcdBuffer << internalTemp.Celsius() << _CELSIUS;
 }
 
 /**
@@ -242,20 +285,22 @@ uint32_t fanSpeedRegulation(uint32_t currentTime) {
  */
 void welcome() {
 
-  lcd.clear();
-  lcd.setCursor(0, LCDTOPROW);
-  lcd << project();
-  lcd.setCursor(0, LCDBOTTOMROW);
-  lcd << _VERSION << _SPACING << version() << _SPACING << _BUILD << _SPACING << build(); 
+  lcdBuffer.clear();
+  lcdBuffer.setCursor(0, LCDTOPROW);
+  lcdBuffer << project();
+  lcdBuffer.setCursor(0, LCDBOTTOMROW);
+  lcdBuffer << _VERSION << _SPACING << version() << _SPACING << _BUILD << _SPACING << build(); 
+  lcdBuffer.flush();
   delay(LCDMESSAGE_DELAY);
-  lcd.clear();
+  lcdBuffer.clear();
 
-  lcd.setCursor(0, 0);
-  lcd.print(_BD);
-  lcd.setCursor(0, 1);
-  lcd.print(_MEDITECH);
+  lcdBuffer.setCursor(0, 0);
+  lcdBuffer.print(_BD);
+  lcdBuffer.setCursor(0, 1);
+  lcdBuffer.print(_MEDITECH);
+  lcdBuffer.flush();
   delay(2500);
-  lcd.clear();
+  lcdBuffer.clear();
 }
 
 /**
@@ -263,8 +308,8 @@ void welcome() {
  *
  * \param m the message string
  */
-void message(String m) {
-  lcd.print(m);
+void message(const char* m) {
+  lcdBuffer.print(m);
 }
 
 /**
@@ -279,8 +324,9 @@ void message(String m) {
  * \param x the cursor column zero based
  * \param y the row number zero based
  */
-void error(String m, int x, int y) {
+void error(const char* m, int x, int y) {
   message(m, x, y);
+  lcdBuffer.flush();
   delay(LCDERROR_DELAY);
 }
 
@@ -294,8 +340,9 @@ void error(String m, int x, int y) {
  *
  * \param m the string message
  */
-void error(String m) {
+void error(const char* m) {
   message(m);
+  lcdBuffer.flush();
   delay(LCDERROR_DELAY);
 }
 
@@ -306,8 +353,8 @@ void error(String m) {
  * \param x the cursor column zero based
  * \param y the row number zero based
  */
-void message(String m, int x, int y) {
-  lcd.setCursor(x, y);
+void message(const char* m, int x, int y) {
+  lcdBuffer.setCursor(x, y);
   message(m);
 }
 
@@ -402,577 +449,284 @@ int setFanSpeed(int freq) {
 /**
   \brief Serial debugging function
 */
-void debug(String msg) {
+void debug(const char* msg) {
 #ifdef __DEBUG
   Serial1 << DEBG_PREFIX << "> " << msg << endl;
 #endif
 }
 
 /**
-  \brief Read a full line buffer from serial
+  \brief Read a binary frame from serial
+  
+  The frame bytes are stored between the opening and closing LINK_DELIMITER.
+  Two consecutive delimiters are considered an opening delimiter, so the
+  receiver is synchronised again after a lost byte. Frames longer than the
+  buffer are discarded.
   
   \parm readch The character read from serial
-  \param buffer The char buffer pointer
-  \param len the las position read in the buffer
-  \return -1 of the number of read characers on the line (if the line ends)
+  \param buffer The frame buffer pointer
+  \param len The frame buffer size
+  \return -1 or the number of the frame bytes (if the frame ends)
   */
-int readline(int readch, char *buffer, int len) {
+int readFrame(int readch, uint8_t *buffer, int len) {
   static int pos = 0;
   int rpos;
 
-  if (readch > 0) {
-    switch (readch) {
-      case '\n': // Ignore new-lines
-        break;
-      case '\r': // Return on CR
-        rpos = pos;
-        pos = 0;  // Reset position index ready for next time
-        return rpos;
-      default:
-        if (pos < len-1) {
-          buffer[pos++] = readch;
-          buffer[pos] = 0;
-        }
-    }
-  }
-  // No end of line has been found, so return -1.
+  if (readch < 0)
+    return -1;
+
+  if (readch == LINK_DELIMITER) {
+    if (!isBinaryFrame || (pos == 0)) {
+      isBinaryFrame = true;
+      pos = 0;
+      return -1;
+    } // Opening delimiter
+    isBinaryFrame = false;
+    rpos = pos;
+    pos = 0;
+    return rpos;
+  } // Delimiter
+
+  if (pos < len)
+    buffer[pos++] = readch;
+  else {
+    isBinaryFrame = false;
+    pos = 0;
+    rxRing.addFramingError();
+  } // Frame too long, discarded
+
   return -1;
 }
   
-/** 
-  \brief Parses the serial input for control command
+/**
+  \brief Execute the LCD template command
+  
+  The display is changed only if the command includes the strings of all
+  the template fields.
   
-  If the syntax checker doesn't recognize any valid command
-  strings are ignored and discharged. Every command is a single-character,
-  case sensitive. All the characters recognised as a command are
-  listed in the CMD_CHARACTERS constant; when the parser starts only those
-  commands included in this string and stored in the cBuff character buffer
-  can be accepted as valid commands, else the string portion is not processed
-  until the next command separator (or the end of the string if there is only
-  one command or it is the last).
+  \param c The decoded command: the template ID and the field strings
+  \return The command result code
   */
-void parser() {
-  //! Counters and indexes. The initaliasation
-  //! matters are these are the correct points for the
-  //! parser recursive process.
-  int i = 0, k = 0, j = 0, value;
-  //! Single-character commands array
-  char c[] = { 'E', 'D', 'L', 'G', 'I', 'T', 'R', 'P', 'r', '\0' };
-  //! The template class instance
-  LCDTemplates mTemplate(lcd);
-  //! The field counter to fill the class fields description
-  int z = 0;
+int showTemplate(command& c) {
   //! The max number of fields of the template class
-  int maxFields = 0;
-  
-  // Initialises the command structure
-//  cmdData[0] = '\0';
-  cmd.message = "";
+  int maxFields = LCDTemplates::getNumFields(c.intValue[0]);
 
-  // Load the command string coming from serial in the character array
-//  while (Serial1.available() > 0)
-//      cmdData[i++] = (char)Serial1.read();
-  
-  // Add the closing command character
-  cmdData[cmd.commandLength] = CMD_SEPARATOR;
-//  cmdData[i] = '\0';
-  
-  i = cmd.commandLength + 1;
-  debug(cmdData);
-  
-  // Here we start processing recursively the array until the end.
-  while (k < i) {
-    
-    // If a command separator is found, anyway we have already finished processing
-    // the command (including eventually an error condition). So the character is
-    // skipped until a new command start is not found.
-    // Using this strategy it is possible to include between two commands or anywhere
-    // outside a valid sequence any kind of comment.
-    if (cmdData[k] == CMD_SEPARATOR)
-      k++;
-
-    // Search for a valid command character and when found set the processing flags.
-    // Else generates an error condition. 
-    for (j = 0; j < CMD_CHARLEN; j++) {
-      
-      // Process the current command character
-      if (c[j] == cmdData[k]) {
-        
-        // Found a matching command
-        switch(cmdData[k]) {
-          // Show a LCD template based on the parameters
-          case CMD_LCDTEMPLATE:
-            appendResponse(CMD_LCDTEMPLATE);
-            // Syntax checking
-            if (!isFieldSeparator(cmdData[++k])) {
-              syntaxCheck(COMMAND_MISSINGSEPARATOR);
-              ackMaster();
-              k = nextCommandSeparator(k);
-              break;
-            } // Check for separator
-            
-            // We expect the next paramter is the template ID
-            value = charsToInt(++k, PARM_FIELDID_LEN);
-            // Check if the template ID exceeds the max number of templates
-            if(value > MAX_TEMPLATES) {
-              syntaxCheck(COMMAND_WRONG_TEMPLATE);
-              ackMaster();
-              k = nextCommandSeparator(k);
-              break;
-            } // Error wrong template ID
-            
-            // Saves the template ID in the template class
-            // And initalises the display parameters
-            mTemplate.id = value;
-            maxFields = mTemplate.createDisplay();
-            // Initialises the field counter
-            z = 0;
-
-            // Update the command string pointer to the next separator
-            k = nextFieldSeparator(k); 
-
-            #ifdef __DEBUG
-            Serial1 << "maxFields=" << maxFields << " k=" << k << endl;
-            #endif
-            
-            // Clear the display before showing another template
-            mTemplate.cleanDisplay();
-            
-            // Now we start processing the fields populating the template class
-            while(z < maxFields) {
-              bool stopLoop = false;
-
-              #ifdef __DEBUG
-              Serial1 << "z=" << z << endl;
-              #endif
-
-              // Syntax checking
-              if (!isFieldSeparator(cmdData[k])) {
-                syntaxCheck(COMMAND_MISSINGSEPARATOR);
-                k = nextCommandSeparator(k);
-                z = maxFields; // force the exit conditions
-                stopLoop = true;
-              }
-              
-              // Start processing the strings only if the stop loop condition
-              // is false (no error)
-              if(!stopLoop) {
-                // We expect the next parameter is the field string
-                cmd.stringValue = charsToString(k);
-                syntaxCheck(COMMAND_OK);
-                
-                #ifdef __DEBUG
-                Serial1 << "Template string " << cmd.stringValue << endl;
-                #endif
-  
-                // Display the message string on LCD
-                mTemplate.updateDisplay(cmd.stringValue, z);
-                
-                // Update the command string pointer to the next separator
-                // We start from the character point immediately after the 
-                // previous field separator found in the loop
-                k = nextFieldSeparator(k+1); 
-
-                z++; // next field
-              } // If stop loop is not set
-            } // While all fields are processes (or exiting on error)
-            ackMaster();
-            break;
-
-          // Show a string on the display.
-          case CMD_DISPLAY:
-            appendResponse(CMD_DISPLAY);
-            // Syntax checking
-            if (!isFieldSeparator(cmdData[++k])) {
-              syntaxCheck(COMMAND_MISSINGSEPARATOR);
-              ackMaster();
-              k = nextCommandSeparator(k);
-              break;
-            }
-            // We expect the next paramter is row expressed in integer format
-            value = charsToInt(++k, PARM_INTEGER_LEN);
-            if (value < LCDROWS) {
-              syntaxCheck(COMMAND_OK);
-              cmd.intValue[0] = value;
-            } // No errors
-            else {
-              syntaxCheck(COMMAND_OUT_OF_RANGE);
-              ackMaster();
-              k = nextCommandSeparator(k);
-              break;
-            } // Error out of range
-            
-            // Update the command string pointer to the next separator
-            k = nextFieldSeparator(k); 
-
-            // Syntax checking
-            if (!isFieldSeparator(cmdData[k])) {
-              syntaxCheck(COMMAND_MISSINGSEPARATOR);
-              ackMaster();
-              k = nextCommandSeparator(k);
-              break;
-            }
-            // We expect the next paramter is column expressed in integer format
-            value = charsToInt(++k, PARM_INTEGER_LEN);
-            if (value < LCDCHARS) {
-              syntaxCheck(COMMAND_OK);
-              cmd.intValue[1] = value;
-            } // No errors
-            else {
-              syntaxCheck(COMMAND_OUT_OF_RANGE);
-              ackMaster();
-              k = nextCommandSeparator(k);
-              break;
-            } // Error out of range
-            
-            // Update the command string pointer to the next separator
-            k = nextFieldSeparator(k); 
-
-            // Syntax checking
-            if (!isFieldSeparator(cmdData[k])) {
-              syntaxCheck(COMMAND_MISSINGSEPARATOR);
-              ackMaster();
-              k = nextCommandSeparator(k);
-              break;
-            }
-            // We expect the next paramter is the data string
-            cmd.stringValue = charsToString(k);
-            syntaxCheck(COMMAND_OK);
-            // Display the message string on LCD
-            message(cmd.stringValue, cmd.intValue[1], cmd.intValue[0]);
-            ackMaster();
-            break;
-
-            // Enable a status on the control panel (mainly a probe setting).
-            // The details of the object to enable are specified in the subcommand
-            case CMD_ENABLE:
-              appendResponse(CMD_ENABLE);
-              // Search for subcommands
-              if (!isFieldSeparator(cmdData[++k])) {
-                syntaxCheck(COMMAND_MISSINGSEPARATOR);
-                ackMaster();
-                k = nextCommandSeparator(k);
-                break;
-              } // Search subcommands
-              
-              cmd.subcommand[0] = cmdData[++k];
-              // Manage the subcommands parameter
-              switch(cmd.subcommand[0]) {
-                
-                // Enable / disable the stethoscope probe control panel settings
-                case S_STETHOSCOPE:
-                  appendResponse(S_STETHOSCOPE);
-                  // Check for subcommand separator
-                  if (!isFieldSeparator(cmdData[++k])) {
-                      syntaxCheck(COMMAND_MISSINGSEPARATOR);
-                      ackMaster();
-                      k = nextCommandSeparator(k);
-                      break;
-                  } // check for separator
-                  if (!setStethoscopeStatus(++k))
-                      syntaxCheck(COMMAND_STETHOSCOPE_PARAMERROR);
-                  else
-                      syntaxCheck(COMMAND_OK);
-                  ackMaster();
-                  k = nextCommandSeparator(k);
-                  break;
-                  
-                // Enable / disable the ECG probe control panel settings
-                case S_ECG:
-                  appendResponse(S_ECG);
-                  // Check for subcommand separator
-                  if (!isFieldSeparator(cmdData[++k])) {
-                      syntaxCheck(COMMAND_MISSINGSEPARATOR);
-                      ackMaster();
-                      k = nextCommandSeparator(k);
-                      break;
-                  } // check for separator
-                  if (!setECGStatus(++k))
-                      syntaxCheck(COMMAND_ECG_PARAMERROR);
-                  else
-                      syntaxCheck(COMMAND_OK);
-                  ackMaster();
-                  k = nextCommandSeparator(k);
-                  break;
-                // Enable / disable the Blood Pressure probe control panel settings
-                case S_PRESSURE:
-                  appendResponse(S_PRESSURE);
-                  // Check for subcommand separator
-                  if (!isFieldSeparator(cmdData[++k])) {
-                      syntaxCheck(COMMAND_MISSINGSEPARATOR);
-                      ackMaster();
-                      k = nextCommandSeparator(k);
-                      break;
-                  } // check for separator
-                  if (!setPressureStatus(++k))
-                      syntaxCheck(COMMAND_PRESSURE_PARAMERROR);
-                  else
-                      syntaxCheck(COMMAND_OK);
-                  ackMaster();
-                  k = nextCommandSeparator(k);
-                  break;
-                  
-                // Enable / disable the Body Temperature probe control panel settings
-                case S_BODYTEMP:
-                  appendResponse(S_BODYTEMP);
-                  // Check for subcommand separator
-                  if (!isFieldSeparator(cmdData[++k])) {
-                      syntaxCheck(COMMAND_MISSINGSEPARATOR);
-                      ackMaster();
-                      k = nextCommandSeparator(k);
-                      break;
-                  } // check for separator
-                  if (!setBodyTempStatus(++k))
-                      syntaxCheck(COMMAND_BODYTEMP_PARAMERROR);
-                  else
-                      syntaxCheck(COMMAND_OK);
-                  ackMaster();
-                  k = nextCommandSeparator(k);
-                  break;
-                  
-                // Enable / disable the Heart Beat probe control panel settings
-                case S_HEARTBEAT:
-                  appendResponse(S_HEARTBEAT);
-                  // Check for subcommand separator
-                  if (!isFieldSeparator(cmdData[++k])) {
-                      syntaxCheck(COMMAND_MISSINGSEPARATOR);
-                      ackMaster();
-                      k = nextCommandSeparator(k);
-                      break;
-                  } // check for separator
-                  if (!setHeartBeatStatus(++k))
-                      syntaxCheck(COMMAND_HEARTBEAT_PARAMERROR);
-                  else
-                      syntaxCheck(COMMAND_OK);
-                  ackMaster();
-                  k = nextCommandSeparator(k);
-                  break;
-                // Subcommand unknown
-                default:
-                    syntaxCheck(PARSER_SUBCOMMAND_UNKNOWN);
-                    ackMaster();
-                    break;
-            } // Subcommands for the Enable command
-            break;
-
-            // Show the global info on the control panel display
-            case CMD_INFO:
-              appendResponse(CMD_INFO);
-              ackMaster();
-            break;
-
-            // Executes a test cycle of the control panel
-            case CMD_TEST:
-              appendResponse(CMD_TEST);
-              ackMaster();
-            break;
-            
-            // If no command is recognised, do nothing
-            default:
-              break;
-        } // Command processing switch case
-        j = CMD_CHARLEN;
-      } // Check with the current command character
-    } // Loop on command characters (syntax checking)
-    k++;
-  } // main while loop
-  i = 0;
+  // The active template is replaced only by a valid command
+  if (maxFields == 0)
+    return COMMAND_WRONG_TEMPLATE;
+  if (c.numStrings < maxFields)
+    return COMMAND_WRONG;
+
+  // Saves the template ID in the template class
+  // And initalises the display parameters
+  activeTemplate.id = c.intValue[0];
+  activeTemplate.createDisplay();
+  // Clear the display before showing another template
+  activeTemplate.cleanDisplay();
+  for (int z = 0; z < maxFields; z++)
+    activeTemplate.updateDisplay(c.stringValue[z], z);
+
+  return COMMAND_OK;
 }
 
 /**
-  \brief Search the position for next command separator
+  \brief Execute the field update command
   
-  This function is used for complex commands to find the first 
-  starting point of a new command (if exist)
-  The function starts from the startChar and ends when a command
-  separator is found. If none exists, the function ends when a
-  null character is encountered.
+  Only the field of the active template is redrawn, the display is not cleared.
   
-  \param startChar initial character in the command string
-  \return the position of the first command separator (if any) 
-  or the last position before the end of the command string.
+  \param c The decoded command: the field ID and the field string
+  \return The command result code
   */
-int nextCommandSeparator(int startChar) {
-  int i = 0;
+int updateField(command& c) {
+  //! The number of fields of the active template
+  int maxFields = LCDTemplates::getNumFields(activeTemplate.id);
 
-  while (cmdData[startChar + i] != '\0') {
-    if (cmdData[startChar + i] == CMD_SEPARATOR)
-      return startChar + i;
-    i++;
-  }
-  return i;
+  if (maxFields == 0)
+    return COMMAND_WRONG_TEMPLATE;
+  if (c.intValue[0] >= maxFields)
+    return COMMAND_OUT_OF_RANGE;
+
+  activeTemplate.updateDisplay(c.stringValue[0], c.intValue[0]);
+
+  return COMMAND_OK;
 }
 
 /**
-  \brief Search the position for next field separator starting from a position
-  
-  This function is used to find the first next field separator starting from the
-  specified position. It should be used instead of the isFieldSeparator() boolean
-  check when the last processed field has a variable length (i.e. strings)
-  
-  \note The use of this function may generate errors so it is best practice after
-  a value is returned to check it in the calling program with isFieldSeparator()
-  function.
+  \brief Execute the display message command
   
-  \param startChar initial character in the command string
-  \return the position of the first command separator (if any) 
-  or the last reached position (end of string)
+  \param c The decoded command: row, column and the message string
+  \return The command result code
   */
-int nextFieldSeparator(int startChar) {
-  int i = 0;
+int showMessage(command& c) {
+  message(c.stringValue[0], c.intValue[1], c.intValue[0]);
 
-  while (cmdData[startChar + i] != '\0') {
-    
-    #ifdef __DEBUG
-    Serial1 << "nextFieldSeparator(" << startChar << ") i = " << i << " char = " << cmdData[startChar + i] << endl;
-    #endif
-    
-    if (cmdData[startChar + i] == FIELD_SEPARATOR)
-      return startChar + i;
-    i++;
-  }
-  return i;
+  return COMMAND_OK;
 }
 
 /**
-  \brief Convert a string to integer
+  \brief Execute the enable command of a probe
   
-  \param startChar initial character in the command string
-  \param numChars number of characters composing the number
-  \return The converted interger value
+  \param c The decoded command: the probe subcommand and the status
+  \return The command result code
   */
-int charsToInt(int startChar, int numChars) {
-  int res = 0;
+int enableProbe(command& c) {
+  switch (c.subcommand[0]) {
+    case S_STETHOSCOPE:
+      return setStethoscopeStatus(c.booleanValue) ? COMMAND_OK : COMMAND_STETHOSCOPE_PARAMERROR;
+    case S_ECG:
+      return setECGStatus(c.booleanValue) ? COMMAND_OK : COMMAND_ECG_PARAMERROR;
+    case S_PRESSURE:
+      return setPressureStatus(c.booleanValue) ? COMMAND_OK : COMMAND_PRESSURE_PARAMERROR;
+    case S_BODYTEMP:
+      return setBodyTempStatus(c.booleanValue) ? COMMAND_OK : COMMAND_BODYTEMP_PARAMERROR;
+    case S_HEARTBEAT:
+      return setHeartBeatStatus(c.booleanValue) ? COMMAND_OK : COMMAND_HEARTBEAT_PARAMERROR;
+    default:
+      return PARSER_SUBCOMMAND_UNKNOWN;
+  } // Subcommands
+}
 
-  res = (int)charsToLong(startChar, numChars);
+/**
+  \brief Execute the info command
+  
+  The reception counters are added to the response before the result code.
   
-  return res;
+  \param c The decoded command
+  \return COMMAND_OK
+  */
+int showInfo(command& c) {
+  appendResponse((long)rxRing.getOverruns());
+  appendResponse((long)rxRing.getFramingErrors());
+  
+  return COMMAND_OK;
 }
 
 /**
-  \brief Convert a portion of the char array command string to string
-  
-  This function does not include the number of characters as it is a variable
-  lenght. The command strings are identified by the initial and final '"'
-  string delimiter character, so the function search for the first delimiter
-  and queue charaters in the destination string until the second string delimiter
-  is not found.\n
-  If no string delimiters are found the cycle stops when reach the CMD_MSGLEN character
-  count limit; in this case an empty string is returned. If only the first string delimiter
-  is found the function returns the entire right string command character array.
-  
-  \warning As the character '"' is used as string delimiter it should not be used as
-  part of the string. Use the ''' instead.
-  
-  \param startChar initial character in the command string
-  \return The converted interger value
+  \brief Execute the commands with no action on the board
+  
+  Used by the test command and by the binary protocol request, as the
+  binary frames are always accepted.
+  
+  \param c The decoded command
+  \return COMMAND_OK
   */
-String charsToString(int startChar) {
-  String temp = "";
-  int i = 0;
-  bool inString = false;
-  
-  // ========================================== FIRST STRING DELIMITER
-  // Search for the first string delimiter
-  while(!inString) {
-    // Check if the current char points to the first string delimiter
-    if(cmdData[i + startChar] == STRING_DELIMITER) {
-      i++;
-      inString = true;
-    } // String delimieter found ?
-    else {
-      // Check for the end of string
-      if(cmdData[i + startChar] == MAX_CMD_LEN) {
-        // Exit with an empty string
-        return "";
-      } // Reached the end of the command string ?
-      else {
-        i++;
-      } // Search to next character
-    } // Delimiter not found
-  } // While out of string
-
-  // ========================================== UNTIL SECOND STRING DELIMITER
-  // Collect the string characters
-  while(inString) {
-    // Check if the current char points to the first string delimiter
-    if(cmdData[i + startChar] == STRING_DELIMITER) {
-      inString = false;
-    } // String delimieter found ?
-    else {
-      // Check for the end of string
-      if(cmdData[i + startChar] == MAX_CMD_LEN) {
-        // Exit with the collected string
-        return temp;
-      } // Reached the end of the command string ?
-      else {
-        // Collect the character in the string and move to next
-        temp.concat(cmdData[i + startChar]);
-        i++;
-      } // Search to next character
-    } // Delimiter not found
-  } // While inside the string
-
-  // Found both delimiters and collected the string.
-  return temp;
+int acceptCommand(command& c) {
+  return COMMAND_OK;
 }
 
 /**
-  \brief Convert a string to long integer
+  \brief The commands accepted by the board
   
-  \param startChar initial character in the command string
-  \param numChars number of characters composing the number
-  \return The converted long interger value
+  Every command is described once with its fields (see CommandParser.h) and
+  its handler; the same description is used for the ASCII commands and the
+  binary frames. The commands not in the table are ignored.
   */
-long charsToLong(int startChar, int numChars) {
-  int i;
-  long res = 0;
-  String extract = "";
-
-  for (i = 0; i < numChars; i++)
-    extract.concat(cmdData[i + startChar]);
-    
-  res = extract.toInt();
+const commandSpec commandTable[] = {
+  { CMD_LCDTEMPLATE, NULL, 2,
+    { { FIELD_ID, MAX_TEMPLATES, COMMAND_WRONG_TEMPLATE },
+      { FIELD_STRINGS, 0, COMMAND_OK } }, showTemplate },
+  { CMD_FIELD, NULL, 2,
+    { { FIELD_ID, MAX_FIELDS, COMMAND_OUT_OF_RANGE },
+      { FIELD_STRING, 0, COMMAND_OK } }, updateField },
+  { CMD_DISPLAY, NULL, 3,
+    { { FIELD_INT, LCDROWS, COMMAND_OUT_OF_RANGE },
+      { FIELD_INT, LCDCHARS, COMMAND_OUT_OF_RANGE },
+      { FIELD_STRING, 0, COMMAND_OK } }, showMessage },
+  { CMD_ENABLE, "SGPTH", 2,
+    { { FIELD_SUBCOMMAND, 0, COMMAND_OK },
+      { FIELD_BOOL, 0, COMMAND_OK } }, enableProbe },
+  { CMD_BINARY, NULL, 1,
+    { { FIELD_BOOL, 0, COMMAND_OK } }, acceptCommand },
+  { CMD_INFO, NULL, 0, { }, showInfo },
+  { CMD_TEST, NULL, 0, { }, acceptCommand }
+};
 
-  return res;
-}
+//! The commands decoder
+CommandParser cmdParser(commandTable, sizeof(commandTable) / sizeof(commandSpec));
 
 /**
-  \brief Convert a string to floating point
+  \brief Execute a decoded command and acknowledge the master
   
-  \param startChar initial character in the command string
-  \param numChars number of characters composing the number
-  \return The converted floating value
+  \param spec The command description
+  \param c The decoded command
+  \param result The decoding result code
   */
-float charsToFloat(int startChar, int numChars) {
-  int i;
-  float res = 0;
-  String extract = "";
+void executeCommand(const commandSpec& spec, command& c, int result) {
+  if ( (c.subcommand[0] != '\0') && (result != PARSER_SUBCOMMAND_UNKNOWN) )
+    appendResponse(c.subcommand[0]);
 
-  for (i = 0; i < numChars; i++)
-    extract.concat(cmdData[i + startChar]);
-    
-  res = extract.toFloat();
+  if (result == COMMAND_OK)
+    result = spec.handler(c);
 
-  return res;
+  syntaxCheck(result);
+  ackMaster();
 }
 
-/**
-  \brief check for separator character
+/** 
+  \brief Parses the serial input for control command
+  
+  The characters are decoded by the cmdParser as they are received, so a
+  command is executed as soon as its command separator (or the end of the
+  line) is received. Every command is a single-character, case sensitive.
+  Only the commands in the commandTable are accepted, else the character is
+  skipped, so any kind of comment can be included between two commands.
   
-  \param test the character to test
-  \return true if test is equal else returns false.
+  \param readch The character read from serial
   */
-boolean isFieldSeparator(char test) {
+void parser(int readch) {
+  int result = cmdParser.feed((char)readch, cmd);
   
-  #ifdef __DEBUG
-  Serial1 << "Field separator=" << test << endl;
-  #endif
+  if (result == PARSE_PENDING)
+    return;
   
-  if (test == FIELD_SEPARATOR)
-      return true;
-  else
-      return false;
+  cmd.message = "";
+  cmd.sequence = cmdParser.getSequence();
+  appendResponse(cmdParser.getCommand()->name);
+  executeCommand(*cmdParser.getCommand(), cmd, result);
+}
+
+/** 
+  \brief Parses a binary frame received from serial
+  
+  The frame is decoded and the CRC verified, then the fields are read with
+  their type as defined in LinkProtocol.h. The commands behave as the
+  corresponding ASCII commands and the same response codes are sent to the
+  master as a binary response frame.
+  
+  \param frameLength The number of the received frame bytes
+  */
+void binaryParser(int frameLength) {
+  //! The decoded frame
+  LinkFrame frame;
+  //! The received command description
+  const commandSpec* spec;
+  //! The decoded command, separated from the ASCII command being received
+  command frameCmd;
+  
+  cmd.message = "";
+  cmd.sequence = NO_SEQUENCE;
+  binaryResponse = true;
+  
+  if (!frame.decode(linkData, frameLength)) {
+    rxRing.addFramingError();
+    syntaxCheck(COMMAND_FRAME_ERROR);
+    ackMaster();
+    binaryResponse = false;
+    return;
+  } // Wrong CRC or encoding
+  
+  if (frame.getSequence() != LINK_NO_SEQUENCE)
+    cmd.sequence = frame.getSequence();
+  appendResponse(frame.getType());
+  spec = cmdParser.find(frame.getType());
+  if (spec != NULL)
+    executeCommand(*spec, frameCmd, cmdParser.decodeFrame(*spec, frame, frameCmd));
+  else {
+    syntaxCheck(COMMAND_UNKNOWN);
+    ackMaster();
+  } // Unknown command
+  
+  binaryResponse = false;
 }
 
 /**
@@ -997,7 +751,7 @@ void syntaxCheck(int errCode) {
   
   \param message The response message to be added, usually a single-character elment or an error code
   */
-void appendResponse(String message) {
+void appendResponse(const char* message) {
   cmd.message.concat(RESPONSE_SEPARATOR);
   cmd.message.concat(message);
 }
@@ -1077,11 +831,70 @@ void appendResponse(float message) {
 /**
   \brief Acknowledge the master caller when a command parsing has been completed
   
+  The response starts with the sequence ID of the command, if any. When the
+  command has been received as binary frame the response string is sent in a
+  LINK_RESPONSE frame with the same sequence ID.
   */
 void ackMaster() {
-  Serial1 << cmd.message << endl;
+  LinkFrame frame;
+  uint8_t buffer[LINK_MAX_FRAME];
+  char response[LINK_MAX_STRING + 1];
+  
+  if (!binaryResponse) {
+    if (cmd.sequence != NO_SEQUENCE)
+      Serial1 << SEQUENCE_MARKER << (cmd.sequence / 10) << (cmd.sequence % 10);
+    Serial1 << cmd.message << endl;
+    return;
+  } // ASCII response
+  
+  cmd.message.toCharArray(response, sizeof(response));
+  frame.begin(LINK_RESPONSE, cmd.sequence == NO_SEQUENCE ? LINK_NO_SEQUENCE : cmd.sequence);
+  frame.addString(response);
+  Serial1.write(buffer, frame.encode(buffer, LINK_MAX_FRAME));
 }
 
+#ifdef __RAM_REPORT
+/**
+  \brief Send a line of the RAM report
+  
+  \param name The buffer name
+  \param size The buffer size in bytes
+  */
+void reportSize(const char* name, int size) {
+  Serial1 << name << " " << size << endl;
+}
+
+/**
+  \brief Send the report of the statically allocated RAM on the serial port
+  
+  All the buffers used by the firmware have a size fixed when it is compiled,
+  so the report shows the whole RAM used by the command processing: the
+  global objects and the largest stack frames of the parsers.
+  */
+void ramReport() {
+  int total = sizeof(cmd) + sizeof(cmdParser) + sizeof(linkData) + sizeof(rxRing) +
+      sizeof(commandTable) + sizeof(lcd) + sizeof(lcdBuffer) +
+      sizeof(activeTemplate) + sizeof(internalTemp);
+  
+  reportSize("cmd", sizeof(cmd));
+  reportSize("cmdParser", sizeof(cmdParser));
+  reportSize("linkData", sizeof(linkData));
+  reportSize("rxRing", sizeof(rxRing));
+  reportSize("commandTable", sizeof(commandTable));
+  reportSize("lcd", sizeof(lcd));
+  reportSize("lcdBuffer", sizeof(lcdBuffer));
+  reportSize("activeTemplate", sizeof(activeTemplate));
+  reportSize("internalTemp", sizeof(internalTemp));
+  reportSize("Static total", total);
+  // binaryParser() calls ackMaster() while its frame is on the stack
+  reportSize("Stack binaryParser", sizeof(LinkFrame) + sizeof(command));
+  reportSize("Stack ackMaster", sizeof(LinkFrame) + LINK_MAX_FRAME + LINK_MAX_STRING + 1);
+#ifdef __STATIC_STRINGS
+  reportSize("Heap", 0);
+#endif
+}
+#endif
+
 /**
   \brief Convert a floating value to string with the specified precision
   
@@ -1126,101 +939,58 @@ void strFloat(float val, unsigned int precision) {
   \biref Set the stethoscope status flag and initialises the
   display parameters if needed.
   
-  \param startChar initial character in the command string
+  \param enable the requested status
+  \return true if the status has been set (both states are accepted)
   \todo Implement this function
   */
-bool setStethoscopeStatus(int startChar) {
-  int res = 0;
-  String extract = "";
-
-  extract.concat(cmdData[startChar]);
-  res = extract.toInt();
-
-  if(res == 0)
-    return false;
-  else
-    return true;
+bool setStethoscopeStatus(bool enable) {
+  return true;
 }
 
 /**
   \biref Set the ECG status flag and initialises the
   display parameters if needed.
   
+  \param enable the requested status
+  \return true if the status has been set (both states are accepted)
   \todo Implement this function
   */
-bool setECGStatus(int startChar) {
-  int res = 0;
-  String extract = "";
-  
-  extract.concat(cmdData[startChar]);
-  res = extract.toInt();
-
-  if(res == 0)
-    return false;
-  else
-    return true;
+bool setECGStatus(bool enable) {
+  return true;
 }
 
 /**
   \biref Set the bood pressure status flag and initialises the
   display parameters if needed.
   
-  \param startChar initial character in the command string
+  \param enable the requested status
+  \return true if the status has been set (both states are accepted)
   \todo Implement this function
   */
-bool setPressureStatus(int startChar) {
-  int res = 0;
-  String extract = "";
-
-  extract.concat(cmdData[startChar]);
-  res = extract.toInt();
-
-  if(res == 0)
-    return false;
-  else
-    return true;
+bool setPressureStatus(bool enable) {
+  return true;
 }
 
 /**
   \biref Set the body temperature status flag and initialises the
   display parameters if needed.
   
-  \param startChar initial character in the command string
+  \param enable the requested status
+  \return true if the status has been set (both states are accepted)
   \todo Implement this function
   */
-bool setBodyTempStatus(int startChar) {
-  int res = 0;
-  String extract = "";
-
-  extract.concat(cmdData[startChar]);
-  res = extract.toInt();
-
-  if(res == 0)
-    return false;
-  else
-    return true;
+bool setBodyTempStatus(bool enable) {
+  return true;
 }
 
 /**
   \biref Set the heart beat status flag and initialises the
   display parameters if needed.
   
-  The function does not need the number of characters parameters as the
-  status ia boolean single character for the flag
-  
-  \param startChar initial character in the command string
+  \param enable the requested status
+  \return true if the status has been set (both states are accepted)
   \todo Implement this function
   */
-bool setHeartBeatStatus(int startChar) {
-  int res = 0;
-  String extract = "";
-  
-  extract.concat(cmdData[startChar]);
-  res = extract.toInt();
-
-  if(res == 0)
-    return false;
-  else
-    return true;
+bool setHeartBeatStatus(bool enable) {
+  return true;
 }
-
@@ -0,0 +1,84 @@
+/**
+  \file RxRing.cpp
+  \brief RxRing class buffers the bytes received from the master between the
+  interrupt service and loop().
+  */
+
+#include "RxRing.h"
+
+/**
+  \brief Class constructor. Creates an empty ring
+  */
+RxRing::RxRing() {
+  head = 0;
+  tail = 0;
+  overruns = 0;
+  framingErrors = 0;
+}
+
+/**
+  \brief Add a received byte. Called by the interrupt service only
+  
+  \param value The received byte
+  \return false if the ring is full and the byte is lost
+  */
+bool RxRing::put(uint8_t value) {
+  uint16_t next = (head + 1) & (RX_RING_SIZE - 1);
+
+  if (next == tail) {
+    overruns++;
+    return false;
+  } // Ring full
+
+  buffer[head] = value;
+  // The byte is stored before it is made visible to loop()
+  head = next;
+
+  return true;
+}
+
+/**
+  \brief Read the oldest received byte. Called by loop() only
+  
+  \return The byte or -1 if the ring is empty
+  */
+int RxRing::get() {
+  uint8_t value;
+
+  if (tail == head)
+    return -1;
+
+  value = buffer[tail];
+  tail = (tail + 1) & (RX_RING_SIZE - 1);
+
+  return value;
+}
+
+/**
+  \brief Return the number of bytes waiting to be read
+  */
+int RxRing::available() {
+  return (head - tail) & (RX_RING_SIZE - 1);
+}
+
+/**
+  \brief Count a frame discarded by the receiver. Called by loop() only
+  */
+void RxRing::addFramingError() {
+  framingErrors++;
+}
+
+/**
+  \brief Return the number of bytes lost because the ring was full
+  */
+uint16_t RxRing::getOverruns() {
+  return overruns;
+}
+
+/**
+  \brief Return the number of frames discarded because wrongly delimited
+  or encoded
+  */
+uint16_t RxRing::getFramingErrors() {
+  return framingErrors;
+}
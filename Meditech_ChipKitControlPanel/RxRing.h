@@ -0,0 +1,53 @@
+/**
+  \file RxRing.h
+  \brief Receive ring buffer of the serial connection with the master.
+  
+  The bytes received from the master are moved in the ring by an interrupt
+  service (see serialReceive() in the main application), so the reception
+  does not depend on how often loop() runs: when loop() is busy, e.g. showing
+  the lid open alarm, the bytes wait in the ring and are processed later.
+  The ring is written only by the interrupt service and read only by loop(),
+  so no lock is needed: every index is written by one side only.
+  
+  The ring counts the bytes lost because it was full (overruns) and the
+  frames discarded because wrongly delimited or encoded (framing errors). The
+  class does not depend on the board libraries, so it is built and exercised
+  on a host by test/RxRingTest.cpp.
+  */
+
+#ifndef __RXRING_H__
+#define __RXRING_H__
+
+#include <stdint.h>
+#include "FixedString.h"
+
+//! The ring size in bytes. Should be a power of 2, as the positions are
+//! wrapped with a mask. At the serial speed the ring holds more than 100 ms
+//! of received data
+#define RX_RING_SIZE 512
+
+STATIC_CHECK((RX_RING_SIZE & (RX_RING_SIZE - 1)) == 0, rxRingSizePowerOfTwo);
+
+class RxRing {
+  public:
+    RxRing();
+    bool put(uint8_t value);
+    int get();
+    int available();
+    void addFramingError();
+    uint16_t getOverruns();
+    uint16_t getFramingErrors();
+  private:
+    //! The received bytes
+    volatile uint8_t buffer[RX_RING_SIZE];
+    //! Position of the next received byte. Written by the interrupt service
+    volatile uint16_t head;
+    //! Position of the next byte to read. Written by loop()
+    volatile uint16_t tail;
+    //! Number of bytes lost with the ring full
+    volatile uint16_t overruns;
+    //! Number of discarded frames
+    uint16_t framingErrors;
+};
+
+#endif
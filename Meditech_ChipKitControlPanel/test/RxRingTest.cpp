@@ -0,0 +1,153 @@
+/**
+  \file RxRingTest.cpp
+  \brief Host test of the RxRing receive ring buffer
+
+  The ring does not depend on the board libraries, so it is built and run on
+  the development host with the test Makefile (make check). The test covers
+  the bytes order, the positions wrap, the overrun and framing error counters
+  and the concurrent use by a producer and a consumer thread, standing for the
+  interrupt service and loop().
+  */
+
+#include "RxRing.h"
+#include <stdio.h>
+#include <pthread.h>
+
+//! Number of bytes moved through the ring by the concurrent test
+#define TEST_STREAM_BYTES 1000000L
+
+//! Number of failed checks
+int failures = 0;
+
+/**
+  \brief Count and report a failed check
+
+  \param condition The checked condition
+  \param name The check description
+  */
+void check(bool condition, const char* name) {
+  if (condition)
+    return;
+
+  failures++;
+  printf("FAILED: %s\n", name);
+}
+
+/**
+  \brief Bytes order and empty ring
+  */
+void testPutGet() {
+  RxRing ring;
+
+  check(ring.get() == -1, "empty ring returns -1");
+  check(ring.put(0x41) && ring.put(0x00) && ring.put(0xFF), "put on empty ring");
+  check(ring.available() == 3, "available counts the bytes");
+  check(ring.get() == 0x41, "first byte");
+  check(ring.get() == 0x00, "zero byte");
+  check(ring.get() == 0xFF, "0xFF byte is not -1");
+  check(ring.get() == -1, "ring empty after reading all the bytes");
+  check(ring.getOverruns() == 0, "no overruns");
+}
+
+/**
+  \brief The positions wrap at the end of the buffer
+  */
+void testWrap() {
+  RxRing ring;
+  bool isOrdered = true;
+
+  for (int j = 0; j < 3 * RX_RING_SIZE; j++) {
+    check(ring.put((uint8_t)j), "put while wrapping");
+    if (ring.get() != (j & 0xFF))
+      isOrdered = false;
+  } // Move the positions around the buffer
+
+  check(isOrdered, "bytes order across the wrap");
+  check(ring.available() == 0, "ring empty after the wrap");
+}
+
+/**
+  \brief The bytes received with the ring full are lost and counted
+  */
+void testOverrun() {
+  RxRing ring;
+  bool isOrdered = true;
+  int stored = 0;
+
+  for (int j = 0; j < RX_RING_SIZE + 10; j++) {
+    if (ring.put((uint8_t)j))
+      stored++;
+  } // Fill the ring
+
+  // A slot is always free to tell the full ring from the empty one
+  check(stored == RX_RING_SIZE - 1, "ring capacity");
+  check(ring.available() == RX_RING_SIZE - 1, "available with the ring full");
+  check(ring.getOverruns() == 11, "overruns counted");
+
+  for (int j = 0; j < stored; j++) {
+    if (ring.get() != (j & 0xFF))
+      isOrdered = false;
+  } // The stored bytes are not changed by the overruns
+  check(isOrdered, "bytes kept with the ring full");
+  check(ring.put(0x55) && (ring.get() == 0x55), "put after an overrun");
+
+  ring.addFramingError();
+  ring.addFramingError();
+  check(ring.getFramingErrors() == 2, "framing errors counted");
+}
+
+/**
+  \brief Producer thread, standing for the interrupt service
+  */
+void* produce(void* context) {
+  RxRing* ring = (RxRing*)context;
+
+  for (long j = 0; j < TEST_STREAM_BYTES; ) {
+    if (ring->put((uint8_t)j))
+      j++;
+  } // Retry the bytes lost with the ring full
+
+  return NULL;
+}
+
+/**
+  \brief Concurrent producer and consumer
+  */
+void testConcurrent() {
+  RxRing ring;
+  pthread_t producer;
+  long errors = 0;
+  int value;
+
+  if (pthread_create(&producer, NULL, produce, &ring) != 0) {
+    check(false, "producer thread");
+    return;
+  } // No thread
+
+  for (long j = 0; j < TEST_STREAM_BYTES; ) {
+    value = ring.get();
+    if (value == -1)
+      continue;
+    if (value != (j & 0xFF))
+      errors++;
+    j++;
+  } // Consume the stream
+
+  pthread_join(producer, NULL);
+  check(errors == 0, "concurrent stream order");
+  check(ring.available() == 0, "concurrent stream fully read");
+}
+
+int main() {
+  testPutGet();
+  testWrap();
+  testOverrun();
+  testConcurrent();
+
+  if (failures > 0) {
+    printf("RxRing: %d checks failed\n", failures);
+    return 1;
+  }
+  printf("RxRing: all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,254 @@
+/**
+ \file AssetPack.cpp
+ \brief AssetPack class builds and maps the voice messages pack.
+ */
+
+#include "AssetPack.h"
+#include "AudioCodec.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ \brief Constructor method
+ */
+AssetPack::AssetPack() {
+	pack = NULL;
+	packSize = 0;
+	count = 0;
+}
+
+/**
+ \brief Destructor method
+ */
+AssetPack::~AssetPack() {
+	close();
+}
+
+/**
+ \brief Map a pack file
+
+ The index is validated, so every asset returned by getAsset() is inside the
+ mapped file.
+
+ \param packName The pack file name
+ \return false if the pack can't be mapped or it is not valid
+ */
+bool AssetPack::open(const char* packName) {
+	struct stat packStatus;
+	const assetPackHeader* header;
+	const assetPackEntry* index;
+	void* mapped;
+	int fd;
+
+	close();
+
+	fd = ::open(packName, O_RDONLY | O_CLOEXEC);
+	if(fd == -1)
+		return false;
+
+	if( (fstat(fd, &packStatus) == -1) ||
+			((size_t)packStatus.st_size < sizeof(assetPackHeader)) ) {
+		::close(fd);
+		return false;
+	} // Not a pack
+
+	mapped = mmap(NULL, packStatus.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping remains valid when the file is closed
+	::close(fd);
+	if(mapped == MAP_FAILED)
+		return false;
+
+	pack = (uint8_t*)mapped;
+	packSize = packStatus.st_size;
+
+	header = (const assetPackHeader*)pack;
+	index = (const assetPackEntry*)(pack + sizeof(assetPackHeader));
+	if( (header->magic != ASSET_PACK_MAGIC) || (header->version != ASSET_PACK_VERSION) ||
+			(header->count > ASSET_MAX_ASSETS) ||
+			(sizeof(assetPackHeader) + header->count * sizeof(assetPackEntry) > packSize) ) {
+		close();
+		return false;
+	} // Wrong header
+
+	for(uint32_t j = 0; j < header->count; j++) {
+		if( (index[j].offset > packSize) || (index[j].length > packSize - index[j].offset) ) {
+			close();
+			return false;
+		} // Asset outside the pack
+	} // Check the index
+
+	count = header->count;
+
+	return true;
+}
+
+/**
+ \brief Unmap the pack
+ */
+void AssetPack::close() {
+	if(pack != NULL)
+		munmap(pack, packSize);
+	pack = NULL;
+	packSize = 0;
+	count = 0;
+}
+
+/**
+ \brief Check if a pack is mapped
+ */
+bool AssetPack::isOpen() {
+	return pack != NULL;
+}
+
+/**
+ \brief Return the data of an asset
+
+ \param assetID The asset ID, from 0
+ \param data Returns the pointer to the mapped asset data
+ \param length Returns the asset data length
+ \param encoding Returns the asset encoding (ASSET_ENCODING_RAW or
+ ASSET_ENCODING_ADPCM)
+ \return false if the asset is not in the pack
+ */
+bool AssetPack::getAsset(int assetID, const uint8_t** data, uint32_t* length,
+		uint32_t* encoding) {
+	const assetPackEntry* index = (const assetPackEntry*)(pack + sizeof(assetPackHeader));
+
+	if( (assetID < 0) || (assetID >= count) || (index[assetID].length == 0) )
+		return false;
+
+	*data = pack + index[assetID].offset;
+	*length = index[assetID].length;
+	*encoding = index[assetID].encoding;
+
+	return true;
+}
+
+/**
+ \brief Build a pack from the asset files
+
+ The asset files are named <folder><n>.<format> with n from 1. A missing file
+ leaves an empty asset. The pack is written to a temporary file then renamed,
+ so a worker mapping the previous pack is not affected.
+
+ \param packName The pack file name
+ \param folder The asset files folder
+ \param format The asset files extension
+ \param numAssets The number of assets
+ \param compress Encode the wav files with IMA-ADPCM (see AudioCodec.h)
+ \return false if the pack can't be written
+ */
+bool AssetPack::build(const char* packName, const char* folder,
+		const char* format, int numAssets, bool compress) {
+	assetPackHeader header;
+	assetPackEntry index[ASSET_MAX_ASSETS];
+	char tempName[128];
+	char fileName[128];
+	off_t offset;
+	bool isBuilt = true;
+	int fd;
+
+	if( (numAssets < 0) || (numAssets > ASSET_MAX_ASSETS) )
+		return false;
+
+	snprintf(tempName, sizeof(tempName), "%s.tmp", packName);
+	fd = ::open(tempName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if(fd == -1)
+		return false;
+
+	header.magic = ASSET_PACK_MAGIC;
+	header.version = ASSET_PACK_VERSION;
+	header.count = numAssets;
+	offset = sizeof(assetPackHeader) + numAssets * sizeof(assetPackEntry);
+
+	for(int j = 0; (j < numAssets) && isBuilt; j++) {
+		// Align the asset to the next page
+		offset = (offset + ASSET_PAGE_SIZE - 1) & ~(off_t)(ASSET_PAGE_SIZE - 1);
+		index[j].offset = offset;
+		index[j].length = 0;
+		index[j].encoding = ASSET_ENCODING_RAW;
+
+		snprintf(fileName, sizeof(fileName), "%s%d.%s", folder, j + 1, format);
+		isBuilt = (lseek(fd, offset, SEEK_SET) == offset) &&
+				writeAsset(fileName, fd, compress, &index[j]);
+		offset += index[j].length;
+	} // Copy the assets
+
+	// The header and the index are written when all the offsets are known
+	isBuilt = isBuilt &&
+			(pwrite(fd, &header, sizeof(header), 0) == sizeof(header)) &&
+			(pwrite(fd, index, numAssets * sizeof(assetPackEntry), sizeof(header)) ==
+				(ssize_t)(numAssets * sizeof(assetPackEntry))) &&
+			(ftruncate(fd, offset) == 0);
+
+	if( (::close(fd) != 0) || !isBuilt ||
+			(rename(tempName, packName) != 0) ) {
+		unlink(tempName);
+		return false;
+	} // Write error
+
+	return true;
+}
+
+/**
+ \brief Append an asset file to the pack
+
+ \param fileName The asset file name
+ \param packFd The pack file, positioned where the asset starts
+ \param compress Encode the 16 bits mono PCM wav files with IMA-ADPCM. The
+ other files are copied unchanged
+ \param entry Returns the asset length and encoding. The length is 0 if the
+ file is missing
+ \return false on write error
+ */
+bool AssetPack::writeAsset(const char* fileName, int packFd, bool compress,
+		assetPackEntry* entry) {
+	struct stat fileStatus;
+	const uint8_t* data;
+	uint8_t* encoded = NULL;
+	uint32_t length;
+	audioClip clip;
+	void* mapped;
+	bool isWritten;
+	int fd;
+
+	entry->length = 0;
+	entry->encoding = ASSET_ENCODING_RAW;
+
+	fd = ::open(fileName, O_RDONLY | O_CLOEXEC);
+	if(fd == -1)
+		return true;	// Missing asset
+	if( (fstat(fd, &fileStatus) == -1) || (fileStatus.st_size == 0) ) {
+		::close(fd);
+		return true;	// Empty asset
+	}
+
+	mapped = mmap(NULL, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(mapped == MAP_FAILED)
+		return false;
+
+	data = (const uint8_t*)mapped;
+	length = fileStatus.st_size;
+	if(compress && AudioCodec::parseWav(data, length, &clip))
+		encoded = (uint8_t*)malloc(AudioCodec::encodedLength(clip.numSamples));
+
+	if(encoded != NULL) {
+		length = AudioCodec::encode(clip, encoded);
+		data = encoded;
+		entry->encoding = ASSET_ENCODING_ADPCM;
+	} // Encoded asset
+
+	isWritten = write(packFd, data, length) == (ssize_t)length;
+	entry->length = length;
+
+	free(encoded);
+	munmap(mapped, fileStatus.st_size);
+
+	return isWritten;
+}
@@ -0,0 +1,97 @@
+/**
+\file AssetPack.h
+\brief Single file pack of the voice message audio files.
+
+ The pack replaces the loose TTS_FOLDER/<n>.meditech files: it is built by the
+ -v generator and memory-mapped once by the voice messages worker, so playing
+ a message does not open, read and close a file on a remote folder. The wav
+ files can be stored IMA-ADPCM encoded (see AudioCodec.h).
+
+ The pack starts with a header and an index with the offset and length of
+ every asset, followed by the assets data. Every asset starts at a page
+ boundary (ASSET_PAGE_SIZE). The header and the index fields are 32 bits
+ words in the host byte order, as the pack is built and read by the same
+ system.
+
+ \verbatim
+ offset 0                 ASSET_PACK_MAGIC
+ offset 4                 ASSET_PACK_VERSION
+ offset 8                 number of assets
+ offset 12 + 12 * n       asset n offset, length (0 if missing), encoding
+ first page boundary      asset 0 data
+ \endverbatim
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef ASSETPACK_H
+#define	ASSETPACK_H
+
+//! Pack file identifier ("MDAP")
+#define ASSET_PACK_MAGIC 0x5041444DUL
+
+//! Pack format version
+#define ASSET_PACK_VERSION 2
+
+//! Alignment of the assets in the pack
+#define ASSET_PAGE_SIZE 4096
+
+//! Max number of assets in a pack
+#define ASSET_MAX_ASSETS 256
+
+//! Asset stored as the original file
+#define ASSET_ENCODING_RAW 0
+
+//! Wav file stored as an IMA-ADPCM encoded stream
+#define ASSET_ENCODING_ADPCM 1
+
+/**
+ \brief The pack header
+ */
+typedef struct AssetPackHeader {
+	//! ASSET_PACK_MAGIC
+	uint32_t magic;
+	//! ASSET_PACK_VERSION
+	uint32_t version;
+	//! Number of index entries following the header
+	uint32_t count;
+} assetPackHeader;
+
+/**
+ \brief A pack index entry
+ */
+typedef struct AssetPackEntry {
+	//! Asset data offset from the start of the pack
+	uint32_t offset;
+	//! Asset data length in bytes
+	uint32_t length;
+	//! Asset data encoding
+	uint32_t encoding;
+} assetPackEntry;
+
+class AssetPack {
+public:
+	AssetPack();
+	virtual ~AssetPack();
+	bool open(const char* packName);
+	void close();
+	bool isOpen();
+	bool getAsset(int assetID, const uint8_t** data, uint32_t* length,
+			uint32_t* encoding);
+
+	static bool build(const char* packName, const char* folder,
+			const char* format, int numAssets, bool compress);
+private:
+	//! The mapped pack or NULL
+	uint8_t* pack;
+	//! The mapped pack size
+	size_t packSize;
+	//! Number of assets in the pack
+	int count;
+
+	static bool writeAsset(const char* fileName, int packFd, bool compress,
+			assetPackEntry* entry);
+};
+
+#endif	/* ASSETPACK_H */
@@ -0,0 +1,386 @@
+/**
+ \file AudioCodec.cpp
+ \brief AudioCodec class encodes and decodes the IMA-ADPCM voice messages.
+ */
+
+#include "AudioCodec.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+//! IMA-ADPCM quantizer step sizes
+static const int16_t STEP_TABLE[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+	253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+	1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+	3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+	11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+	32767
+};
+
+//! IMA-ADPCM step index changes for every code
+static const int8_t INDEX_TABLE[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+/**
+ \brief Read a 16 bits little endian value
+ */
+static inline uint16_t readLE16(const uint8_t* p) {
+	return p[0] | (p[1] << 8);
+}
+
+/**
+ \brief Read a 32 bits little endian value
+ */
+static inline uint32_t readLE32(const uint8_t* p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ \brief Write a 16 bits little endian value
+ */
+static inline void writeLE16(uint8_t* p, uint16_t value) {
+	p[0] = value & 0xFF;
+	p[1] = value >> 8;
+}
+
+/**
+ \brief Write a 32 bits little endian value
+ */
+static inline void writeLE32(uint8_t* p, uint32_t value) {
+	p[0] = value & 0xFF;
+	p[1] = (value >> 8) & 0xFF;
+	p[2] = (value >> 16) & 0xFF;
+	p[3] = value >> 24;
+}
+
+/**
+ \brief Read from a file until the buffer is full or the file ends
+
+ \return The number of bytes read
+ */
+static uint32_t readFull(int fd, uint8_t* buffer, uint32_t length) {
+	uint32_t filled = 0;
+	ssize_t received;
+
+	while(filled < length) {
+		received = read(fd, buffer + filled, length - filled);
+		if( (received == -1) && (errno == EINTR) )
+			continue;
+		if(received <= 0)
+			break;
+		filled += received;
+	} // Fill the buffer
+
+	return filled;
+}
+
+/**
+ \brief Encode a sample updating the predictor and the step index
+
+ \return The 4 bits code
+ */
+static inline uint8_t encodeSample(int sample, int* predictor, int* index) {
+	int step = STEP_TABLE[*index];
+	int diff = sample - *predictor;
+	int delta = step >> 3;
+	uint8_t code = 0;
+
+	if(diff < 0) {
+		code = 8;
+		diff = -diff;
+	}
+	if(diff >= step) {
+		code |= 4;
+		diff -= step;
+		delta += step;
+	}
+	step >>= 1;
+	if(diff >= step) {
+		code |= 2;
+		diff -= step;
+		delta += step;
+	}
+	step >>= 1;
+	if(diff >= step) {
+		code |= 1;
+		delta += step;
+	}
+
+	*predictor += (code & 8) ? -delta : delta;
+	if(*predictor > 32767)
+		*predictor = 32767;
+	else if(*predictor < -32768)
+		*predictor = -32768;
+
+	*index += INDEX_TABLE[code];
+	if(*index < 0)
+		*index = 0;
+	else if(*index > 88)
+		*index = 88;
+
+	return code;
+}
+
+/**
+ \brief Decode a sample updating the predictor and the step index
+
+ \return The decoded sample
+ */
+static inline int16_t decodeSample(uint8_t code, int* predictor, int* index) {
+	int step = STEP_TABLE[*index];
+	int delta = step >> 3;
+
+	if(code & 4)
+		delta += step;
+	if(code & 2)
+		delta += step >> 1;
+	if(code & 1)
+		delta += step >> 2;
+
+	*predictor += (code & 8) ? -delta : delta;
+	if(*predictor > 32767)
+		*predictor = 32767;
+	else if(*predictor < -32768)
+		*predictor = -32768;
+
+	*index += INDEX_TABLE[code];
+	if(*index < 0)
+		*index = 0;
+	else if(*index > 88)
+		*index = 88;
+
+	return *predictor;
+}
+
+/**
+ \brief Find the samples of a 16 bits mono PCM wav file
+
+ \param wav The wav file content
+ \param length The wav file length
+ \param clip Returns the samples
+ \return false if the file is not a 16 bits mono PCM wav file
+ */
+bool AudioCodec::parseWav(const uint8_t* wav, uint32_t length, audioClip* clip) {
+	uint32_t pos = 12;
+	bool isPCM = false;
+
+	if( (length < 12) || (memcmp(wav, "RIFF", 4) != 0) || (memcmp(wav + 8, "WAVE", 4) != 0) )
+		return false;
+
+	while(pos + 8 <= length) {
+		uint32_t chunkLength = readLE32(wav + pos + 4);
+		const uint8_t* chunk = wav + pos + 8;
+
+		if( (memcmp(wav + pos, "fmt ", 4) == 0) && (chunkLength >= 16) ) {
+			isPCM = (readLE16(chunk) == 1) && (readLE16(chunk + 2) == 1) &&
+					(readLE16(chunk + 14) == 16);
+			clip->sampleRate = readLE32(chunk + 4);
+		} // Format chunk
+		else if(memcmp(wav + pos, "data", 4) == 0) {
+			// A streamed wav file can have a wrong data length
+			if(chunkLength > length - pos - 8)
+				chunkLength = length - pos - 8;
+			clip->samples = chunk;
+			clip->numSamples = chunkLength / 2;
+			return isPCM;
+		} // Samples chunk
+
+		pos += 8 + chunkLength + (chunkLength & 1);
+	} // Search the chunks
+
+	return false;
+}
+
+/**
+ \brief Return the encoded stream length of a clip
+
+ \param numSamples The number of samples
+ */
+uint32_t AudioCodec::encodedLength(uint32_t numSamples) {
+	uint32_t blocks = numSamples / ADPCM_BLOCK_SAMPLES;
+	uint32_t remainder = numSamples % ADPCM_BLOCK_SAMPLES;
+	uint32_t length = ADPCM_HEADER_LEN + blocks * ADPCM_BLOCK_LEN;
+
+	if(remainder > 0)
+		length += ADPCM_BLOCK_HEADER_LEN + remainder / 2;
+
+	return length;
+}
+
+/**
+ \brief Encode a clip
+
+ \param clip The clip
+ \param encoded The encoded stream buffer, at least encodedLength() bytes
+ \return The encoded stream length
+ */
+uint32_t AudioCodec::encode(const audioClip& clip, uint8_t* encoded) {
+	uint8_t* out = encoded + ADPCM_HEADER_LEN;
+	int predictor;
+	int index = 0;
+	uint32_t pos = 0;
+
+	writeLE32(encoded, ADPCM_MAGIC);
+	writeLE32(encoded + 4, clip.sampleRate);
+	writeLE32(encoded + 8, clip.numSamples);
+
+	while(pos < clip.numSamples) {
+		uint32_t blockSamples = clip.numSamples - pos;
+		if(blockSamples > ADPCM_BLOCK_SAMPLES)
+			blockSamples = ADPCM_BLOCK_SAMPLES;
+
+		// The block starts from an exact sample so the blocks are independent
+		predictor = (int16_t)readLE16(clip.samples + pos * 2);
+		writeLE16(out, predictor);
+		out[2] = index;
+		out[3] = 0;
+		out += ADPCM_BLOCK_HEADER_LEN;
+
+		for(uint32_t j = 1; j < blockSamples; j += 2) {
+			uint8_t code = encodeSample((int16_t)readLE16(clip.samples + (pos + j) * 2),
+					&predictor, &index);
+			if(j + 1 < blockSamples)
+				code |= encodeSample((int16_t)readLE16(clip.samples + (pos + j + 1) * 2),
+						&predictor, &index) << 4;
+			*out++ = code;
+		} // Encode the sample pairs
+
+		pos += blockSamples;
+	} // Encode the blocks
+
+	return out - encoded;
+}
+
+/**
+ \brief Decode an encoded stream
+
+ \param encoded The encoded stream
+ \param length The encoded stream length
+ \param samples The samples buffer, at least the number of samples in the
+ stream header
+ \return The number of decoded samples
+ */
+uint32_t AudioCodec::decode(const uint8_t* encoded, uint32_t length, int16_t* samples) {
+	uint32_t numSamples;
+	uint32_t decoded = 0;
+	uint32_t pos = ADPCM_HEADER_LEN;
+
+	if( (length < ADPCM_HEADER_LEN) || (readLE32(encoded) != ADPCM_MAGIC) )
+		return 0;
+	numSamples = readLE32(encoded + 8);
+
+	while( (pos < length) && (decoded < numSamples) ) {
+		uint32_t blockLength = length - pos;
+		if(blockLength > ADPCM_BLOCK_LEN)
+			blockLength = ADPCM_BLOCK_LEN;
+
+		decoded += decodeBlock(encoded + pos, blockLength, samples + decoded,
+				numSamples - decoded);
+		pos += blockLength;
+	} // Decode the blocks
+
+	return decoded;
+}
+
+/**
+ \brief Decode an encoded stream to a wav stream
+
+ Used by the audio node to play the encoded messages: the stream is read from
+ the input and the wav data is written to the output block by block.
+
+ \param inFd The encoded stream input
+ \param outFd The wav stream output
+ \return false if the input is not an encoded stream or on write error
+ */
+bool AudioCodec::decodeStream(int inFd, int outFd) {
+	uint8_t block[ADPCM_BLOCK_LEN];
+	int16_t samples[ADPCM_BLOCK_SAMPLES];
+	uint8_t header[WAV_HEADER_LEN];
+	uint32_t filled;
+	uint32_t remaining;
+	ssize_t sent;
+
+	filled = readFull(inFd, block, ADPCM_HEADER_LEN);
+	if( (filled < ADPCM_HEADER_LEN) || (readLE32(block) != ADPCM_MAGIC) )
+		return false;
+
+	remaining = readLE32(block + 8);
+	buildWavHeader(header, readLE32(block + 4), remaining);
+	if(write(outFd, header, WAV_HEADER_LEN) != WAV_HEADER_LEN)
+		return false;
+
+	while(remaining > 0) {
+		filled = readFull(inFd, block, ADPCM_BLOCK_LEN);
+		if(filled == 0)
+			break;	// Truncated stream
+
+		uint32_t decoded = decodeBlock(block, filled, samples, remaining);
+		remaining -= decoded;
+
+		// The samples are written in the host byte order, little endian on the Pi
+		for(uint32_t done = 0; done < decoded * 2; done += sent) {
+			sent = write(outFd, (uint8_t*)samples + done, decoded * 2 - done);
+			if(sent <= 0)
+				return false;
+		} // Write the samples
+	} // Decode the blocks
+
+	return true;
+}
+
+/**
+ \brief Build the header of a 16 bits mono PCM wav file
+
+ \param header The header buffer, WAV_HEADER_LEN bytes
+ \param sampleRate Samples per second
+ \param numSamples Number of samples
+ */
+void AudioCodec::buildWavHeader(uint8_t* header, uint32_t sampleRate, uint32_t numSamples) {
+	memcpy(header, "RIFF", 4);
+	writeLE32(header + 4, WAV_HEADER_LEN - 8 + numSamples * 2);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	writeLE32(header + 16, 16);
+	writeLE16(header + 20, 1);	// PCM
+	writeLE16(header + 22, 1);	// Mono
+	writeLE32(header + 24, sampleRate);
+	writeLE32(header + 28, sampleRate * 2);
+	writeLE16(header + 32, 2);	// Bytes per frame
+	writeLE16(header + 34, 16);	// Bits per sample
+	memcpy(header + 36, "data", 4);
+	writeLE32(header + 40, numSamples * 2);
+}
+
+/**
+ \brief Decode a block
+
+ \param block The encoded block
+ \param length The block length, up to ADPCM_BLOCK_LEN
+ \param samples The samples buffer
+ \param maxSamples The samples buffer size
+ \return The number of decoded samples
+ */
+uint32_t AudioCodec::decodeBlock(const uint8_t* block, uint32_t length,
+		int16_t* samples, uint32_t maxSamples) {
+	int predictor;
+	int index;
+	uint32_t decoded = 0;
+
+	if( (length < ADPCM_BLOCK_HEADER_LEN) || (maxSamples == 0) )
+		return 0;
+
+	predictor = (int16_t)readLE16(block);
+	index = block[2] > 88 ? 88 : block[2];
+	samples[decoded++] = predictor;
+
+	for(uint32_t j = ADPCM_BLOCK_HEADER_LEN; (j < length) && (decoded < maxSamples); j++) {
+		samples[decoded++] = decodeSample(block[j] & 0x0F, &predictor, &index);
+		if(decoded < maxSamples)
+			samples[decoded++] = decodeSample(block[j] >> 4, &predictor, &index);
+	} // Decode the sample pairs
+
+	return decoded;
+}
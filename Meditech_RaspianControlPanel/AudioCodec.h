@@ -0,0 +1,72 @@
+/**
+\file AudioCodec.h
+\brief IMA-ADPCM encoding of the voice messages.
+
+ The voice messages generated by festival are 16 bits mono PCM wav files. They
+ are stored in the voice messages pack encoded with the IMA-ADPCM codec (4 bits
+ per sample), so the pack and the data sent to the audio node are about four
+ times smaller. The decoding needs a few integer operations per sample and
+ runs on the audio node, as a filter between the ssh connection and the player
+ (see AudioDecoder.cpp).
+
+ The encoded stream has a header followed by independent blocks, so the
+ decoder needs a single block in memory:
+
+ \verbatim
+ header   ADPCM_MAGIC, sample rate, number of samples (32 bits little endian)
+ block    first sample (16 bits), step index (8 bits), 0 (8 bits),
+          ADPCM_BLOCK_SAMPLES - 1 samples, 4 bits each, low nibble first
+ \endverbatim
+
+ The last block is shorter if the samples do not fill it.
+ */
+
+#include <stdint.h>
+
+#ifndef AUDIOCODEC_H
+#define	AUDIOCODEC_H
+
+//! Encoded stream identifier ("MDAC")
+#define ADPCM_MAGIC 0x4341444DUL
+
+//! Encoded stream header length
+#define ADPCM_HEADER_LEN 12
+
+//! Encoded block length
+#define ADPCM_BLOCK_LEN 256
+
+//! Block header length
+#define ADPCM_BLOCK_HEADER_LEN 4
+
+//! Samples in a block: the header sample and two samples per byte
+#define ADPCM_BLOCK_SAMPLES (1 + (ADPCM_BLOCK_LEN - ADPCM_BLOCK_HEADER_LEN) * 2)
+
+//! Length of the wav header written by the decoder
+#define WAV_HEADER_LEN 44
+
+/**
+ \brief A 16 bits mono PCM clip
+ */
+typedef struct AudioClip {
+	//! The samples, 16 bits little endian, not necessarily aligned
+	const uint8_t* samples;
+	//! Number of samples
+	uint32_t numSamples;
+	//! Samples per second
+	uint32_t sampleRate;
+} audioClip;
+
+class AudioCodec {
+public:
+	static bool parseWav(const uint8_t* wav, uint32_t length, audioClip* clip);
+	static uint32_t encodedLength(uint32_t numSamples);
+	static uint32_t encode(const audioClip& clip, uint8_t* encoded);
+	static uint32_t decode(const uint8_t* encoded, uint32_t length, int16_t* samples);
+	static bool decodeStream(int inFd, int outFd);
+	static void buildWavHeader(uint8_t* header, uint32_t sampleRate, uint32_t numSamples);
+private:
+	static uint32_t decodeBlock(const uint8_t* block, uint32_t length,
+			int16_t* samples, uint32_t maxSamples);
+};
+
+#endif	/* AUDIOCODEC_H */
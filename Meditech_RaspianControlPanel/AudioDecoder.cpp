@@ -0,0 +1,25 @@
+/**
+ \file AudioDecoder.cpp
+ \brief Voice messages decoder run on the audio node.
+
+ Reads an IMA-ADPCM encoded voice message from the standard input and writes
+ the wav stream to the standard output, as a filter between the ssh
+ connection and the player (see AUDIO_DECODE_COMMAND). The program is built
+ with the AudioCodec class only, so the audio node does not need the
+ controller libraries (lirc, wiringPi) to play the messages.
+ */
+
+#include "AudioCodec.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ \brief main The decoder entry point
+
+ The standard output is the decoded stream, so no messages are written.
+
+ \return 0 if the message has been decoded, else EXIT_FAILURE
+ */
+int main(void) {
+	return AudioCodec::decodeStream(STDIN_FILENO, STDOUT_FILENO) ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,622 @@
+/**
+ \file AudioDispatcher.cpp
+ \brief AudioDispatcher class manages the voice messages worker process.
+ */
+
+#include "AudioDispatcher.h"
+#include "MessageStrings.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <dirent.h>
+
+/**
+ \brief Constructor method
+ */
+AudioDispatcher::AudioDispatcher() {
+	commandPipe = -1;
+	workerPid = -1;
+	statusFd = -1;
+	startTime = 0;
+	restarts = 0;
+	isEnded = false;
+	signalFd = -1;
+	reportFd = -1;
+	connectTimer = -1;
+	playerPid = -1;
+	connectionPid = -1;
+	connectionTime = 0;
+	reconnects = 0;
+	reconnectTime = 0;
+	count = 0;
+	playingClass = -1;
+	for(int j = 0; j < TTS_MAX_MESSAGES; j++)
+		acceptedTime[j] = AUDIO_NEVER_ACCEPTED;
+	streamFd = -1;
+	streamData = NULL;
+	streamLength = 0;
+}
+
+/**
+ \brief Destructor method
+ */
+AudioDispatcher::~AudioDispatcher() {
+	stop();
+}
+
+/**
+ \brief Create the worker process
+
+ The SIGCHLD signal should be blocked by the caller, so the worker inherits
+ the blocked signal and receives it through the signalfd. The worker does not
+ run a new program, so the descriptors opened by the controller (e.g. the
+ UART and the lirc socket when the worker is restarted) are closed by the
+ worker itself.
+
+ \return false if the worker can't be created
+ */
+bool AudioDispatcher::start() {
+	int fds[2];
+	int statusFds[2];
+
+	stop();
+	// The players and the ssh connection should not hold the command pipe,
+	// or the worker end would not be noticed
+	if(pipe2(fds, O_CLOEXEC) == -1)
+		return false;
+	if(pipe2(statusFds, O_CLOEXEC | O_NONBLOCK) == -1) {
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	} // Pipe error
+
+	workerPid = fork();
+	if(workerPid == -1) {
+		close(fds[0]);
+		close(fds[1]);
+		close(statusFds[0]);
+		close(statusFds[1]);
+		return false;
+	} // Fork error
+
+	if(workerPid == 0) {
+		close(fds[1]);
+		close(statusFds[0]);
+		closeInherited(fds[0], statusFds[1]);
+		reportFd = statusFds[1];
+		run(fds[0]);
+		_exit(0);
+	} // Worker process
+
+	close(fds[0]);
+	close(statusFds[1]);
+	statusFd = statusFds[0];
+	startTime = EventLoop::currentTime();
+	commandPipe = fds[1];
+	// A message is discarded instead of blocking the controller
+	fcntl(commandPipe, F_SETFL, fcntl(commandPipe, F_GETFL) | O_NONBLOCK);
+
+	return true;
+}
+
+/**
+ \brief Send a message to the worker to be played
+
+ The controller ignores SIGPIPE, so a worker ended before its SIGCHLD is
+ handled makes the write fail with EPIPE: the worker should then be restarted
+ (see hasEnded()).
+
+ \param messageID The message ID
+ \return false if the worker is not running or it is busy
+ */
+bool AudioDispatcher::play(int messageID) {
+	if(commandPipe == -1)
+		return false;
+
+	if(write(commandPipe, &messageID, sizeof(messageID)) == sizeof(messageID))
+		return true;
+
+	if(errno == EPIPE)
+		isEnded = true;
+	return false;
+}
+
+/**
+ \brief Check if the worker has been found ended by play()
+ */
+bool AudioDispatcher::hasEnded() {
+	return isEnded;
+}
+
+/**
+ \brief Close the command pipe. The worker ends when it reads the pipe end.
+ */
+void AudioDispatcher::stop() {
+	if(commandPipe != -1)
+		close(commandPipe);
+	if(statusFd != -1)
+		close(statusFd);
+	commandPipe = -1;
+	statusFd = -1;
+	workerPid = -1;
+	isEnded = false;
+}
+
+/**
+ \brief Return the delay before the restart of an ended worker
+
+ See getBackoffDelay().
+
+ \return The restart delay (ms), 0 for an immediate restart or -1 if the
+ worker should not be restarted
+ */
+int AudioDispatcher::getRestartDelay() {
+	return getBackoffDelay(startTime, restarts);
+}
+
+/**
+ \brief Return the worker process id or -1 if not started
+ */
+pid_t AudioDispatcher::getPid() {
+	return workerPid;
+}
+
+/**
+ \brief Return the read end of the status pipe or -1 if not started
+
+ The pipe receives a single AUDIO_STATUS_READY or AUDIO_STATUS_FAILED byte.
+ */
+int AudioDispatcher::getStatusFd() {
+	return statusFd;
+}
+
+/**
+ \brief Restore the signals in a child process before launching a new program
+
+ The signal mask and the ignored signals are inherited by the programs
+ launched with exec, so the SIGCHLD blocked for the signalfd is unblocked and
+ the SIGPIPE ignored by the controller and the worker is restored.
+ */
+void AudioDispatcher::unblockSignals() {
+	sigset_t mask;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	sigprocmask(SIG_UNBLOCK, &mask, NULL);
+	signal(SIGPIPE, SIG_DFL);
+}
+
+/**
+ \brief Worker side: close the descriptors inherited from the controller
+
+ The standard streams and the worker pipes are kept open.
+
+ \param pipeFd The read end of the command pipe
+ \param reportPipe The write end of the status pipe
+ */
+void AudioDispatcher::closeInherited(int pipeFd, int reportPipe) {
+	DIR* dir = opendir(AUDIO_FD_DIR);
+	struct dirent* entry;
+	int fd;
+
+	if(dir == NULL)
+		return;
+
+	while( (entry = readdir(dir)) != NULL) {
+		fd = atoi(entry->d_name);
+		if( (fd > STDERR_FILENO) && (fd != pipeFd) && (fd != reportPipe) && (fd != dirfd(dir)) )
+			close(fd);
+	} // Close the controller descriptors
+
+	closedir(dir);
+}
+
+/**
+ \brief Worker main loop
+
+ \param pipeFd The read end of the command pipe
+ */
+void AudioDispatcher::run(int pipeFd) {
+	sigset_t mask;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &mask, NULL);
+	signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	// A player ending before reading all the data should not end the worker
+	signal(SIGPIPE, SIG_IGN);
+
+	if( (signalFd == -1) || !loop.open() ||
+			!loop.addWatch(pipeFd, EPOLLIN, commandEvent, this) ||
+			!loop.addWatch(signalFd, EPOLLIN, childEvent, this) ) {
+		fprintf(stderr, AUDIO_WORKER_ERROR);
+		return;
+	} // Loop setup error
+
+	if(!assets.open(AUDIO_PACK)) {
+		fprintf(stderr, AUDIO_PACK_ERROR);
+		report(false);
+	} // No messages to play
+
+	openConnection();
+	if(AUDIO_REMOTE_HOST[0] == '\0')
+		report(true);	// Local player
+	else
+		connectTimer = loop.addTimer(AUDIO_CONNECT_POLL, connectEvent, this);
+	loop.run();
+
+	if(connectionPid != -1)
+		kill(connectionPid, SIGTERM);
+}
+
+/**
+ \brief Send the worker status to the controller
+
+ Only the first status is sent.
+
+ \param isReady true if the messages can be played
+ */
+void AudioDispatcher::report(bool isReady) {
+	char status = isReady ? AUDIO_STATUS_READY : AUDIO_STATUS_FAILED;
+
+	if(reportFd == -1)
+		return;
+
+	write(reportFd, &status, 1);
+	close(reportFd);
+	reportFd = -1;
+}
+
+/**
+ \brief Add a message to the playing queue
+
+ The repeated messages are ignored. A waiting message of the same class is
+ removed and the playing message of the same class is interrupted. The power
+ messages are queued after the other power messages, before all the others,
+ and interrupt any playing message.
+
+ \param messageID The message ID
+ */
+void AudioDispatcher::enqueue(int messageID) {
+	long now = EventLoop::currentTime();
+	int messageClass = getClass(messageID);
+	bool isUrgent = messageClass == AUDIO_CLASS_POWER;
+	int pos;
+
+	if( (messageID < 0) || (messageID >= TTS_MAX_MESSAGES) )
+		return;	// Unknown message
+	if( (acceptedTime[messageID] != AUDIO_NEVER_ACCEPTED) &&
+			(now - acceptedTime[messageID] < AUDIO_DEDUPE_WINDOW) )
+		return;	// Repeated message
+	acceptedTime[messageID] = now;
+
+	for(pos = 0; pos < count; pos++) {
+		if(getClass(queue[pos]) == messageClass) {
+			memmove(queue + pos, queue + pos + 1, (count - pos - 1) * sizeof(int));
+			count--;
+			break;
+		} // Stale message
+	} // Search a waiting message of the same class
+
+	if( (playerPid != -1) && (isUrgent || (playingClass == messageClass)) ) {
+		stopStream();
+		kill(playerPid, SIGTERM);
+	} // Interrupt the playing message
+
+	if(count == AUDIO_QUEUE_SIZE) {
+		if(!isUrgent)
+			return;	// Queue full
+		count--;
+	} // The urgent messages replace the last waiting message
+
+	pos = count;
+	if(isUrgent) {
+		for(pos = 0; (pos < count) && (getClass(queue[pos]) == AUDIO_CLASS_POWER); pos++)
+			;
+		memmove(queue + pos + 1, queue + pos, (count - pos) * sizeof(int));
+	} // Jump the queue
+	queue[pos] = messageID;
+	count++;
+
+	playNext();
+}
+
+/**
+ \brief Start playing the next waiting message if no message is playing
+
+ The messages that can't be played (e.g. missing from the pack) are discarded.
+ */
+void AudioDispatcher::playNext() {
+	if( (playerPid != -1) || (count == 0) )
+		return;
+
+	if( (connectionPid == -1) && (AUDIO_REMOTE_HOST[0] != '\0') &&
+			(reconnectTime != AUDIO_NO_RECONNECT) &&
+			(EventLoop::currentTime() >= reconnectTime) )
+		openConnection();
+
+	while( (playerPid == -1) && (count > 0) ) {
+		playerPid = spawnPlayer(queue[0]);
+		playingClass = getClass(queue[0]);
+		memmove(queue, queue + 1, (count - 1) * sizeof(int));
+		count--;
+	} // Play the first playable message
+}
+
+/**
+ \brief Open the ssh master connection shared by the players
+
+ The connection runs in a child process for the whole worker life. If the
+ connection is not yet ready (or fails) the players open their own connection.
+ A connection closed too early is opened again by playNext() after the same
+ delay used for the worker restarts (see getBackoffDelay()).
+ */
+void AudioDispatcher::openConnection() {
+	char* arg_list[] = {
+		(char*)"ssh",
+		(char*)"-M",
+		(char*)"-N",
+		(char*)"-S",
+		(char*)AUDIO_CONTROL_SOCKET,
+		(char*)AUDIO_REMOTE_HOST,
+		NULL
+	};
+
+	if(AUDIO_REMOTE_HOST[0] == '\0')
+		return;	// Local player
+
+	// A socket left by a previous connection would disable the new one
+	unlink(AUDIO_CONTROL_SOCKET);
+	connectionTime = EventLoop::currentTime();
+	connectionPid = fork();
+	if(connectionPid == 0) {
+		unblockSignals();
+		execvp(arg_list[0], arg_list);
+		_exit(EXIT_FAILURE);
+	} // Connection process
+}
+
+/**
+ \brief Launch the player of a message
+
+ The player reads the audio data from its standard input. The IMA-ADPCM
+ encoded messages are decoded on the remote host before the player. The data
+ is written to the player input pipe by streamEvent() as the pipe accepts it;
+ when an interrupted player closes the connection channel the remote player
+ reads the end of the data and ends.
+
+ \param messageID The message ID
+ \return The player process id or -1 on error
+ */
+pid_t AudioDispatcher::spawnPlayer(int messageID) {
+	const uint8_t* data;
+	uint32_t length;
+	uint32_t encoding;
+	int fds[2];
+	pid_t pid;
+
+	if(!assets.getAsset(messageID, &data, &length, &encoding))
+		return -1;
+	if(pipe2(fds, O_CLOEXEC) == -1)
+		return -1;
+
+	char* command = (char*)(encoding == ASSET_ENCODING_ADPCM ?
+			AUDIO_DECODE_COMMAND : AUDIO_PLAY_COMMAND);
+	char* remote_list[] = {
+		(char*)"ssh",
+		(char*)"-S",
+		(char*)AUDIO_CONTROL_SOCKET,
+		(char*)AUDIO_REMOTE_HOST,
+		command,
+		NULL
+	};
+	char* local_list[] = {
+		(char*)"sh",
+		(char*)"-c",
+		command,
+		NULL
+	};
+	char** arg_list = remote_list;
+
+	if(AUDIO_REMOTE_HOST[0] == '\0')
+		arg_list = local_list;	// Local player
+
+	pid = fork();
+	if(pid == 0) {
+		dup2(fds[0], STDIN_FILENO);
+		unblockSignals();
+		execvp(arg_list[0], arg_list);
+		_exit(EXIT_FAILURE);
+	} // Player process
+
+	close(fds[0]);
+	if(pid == -1) {
+		close(fds[1]);
+		return -1;
+	} // Fork error
+
+	fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+	streamFd = fds[1];
+	streamData = data;
+	streamLength = length;
+	if(!loop.addWatch(streamFd, EPOLLOUT, streamEvent, this))
+		stopStream();
+
+	return pid;
+}
+
+/**
+ \brief Close the player input pipe
+
+ The player reads the end of the data and ends when the data already in the
+ pipe is played.
+ */
+void AudioDispatcher::stopStream() {
+	if(streamFd == -1)
+		return;
+
+	loop.removeWatch(streamFd);
+	close(streamFd);
+	streamFd = -1;
+	streamLength = 0;
+}
+
+/**
+ \brief Stop the connection readiness check
+ */
+void AudioDispatcher::stopConnectTimer() {
+	if(connectTimer == -1)
+		return;
+
+	loop.removeTimer(connectTimer);
+	connectTimer = -1;
+}
+
+/**
+ \brief Return the delay before a process ended too early is started again
+
+ A process failing its setup ends at once: the restarts of a process ended
+ before AUDIO_STABLE_TIME are delayed, doubling the delay every time, and
+ after AUDIO_MAX_RESTARTS the process is no more restarted.
+
+ \param startedTime The time the process has been started (ms)
+ \param count The number of consecutive restarts, updated
+ \return The restart delay (ms), 0 for an immediate restart or -1 if the
+ process should not be restarted
+ */
+int AudioDispatcher::getBackoffDelay(long startedTime, int& count) {
+	if(EventLoop::currentTime() - startedTime >= AUDIO_STABLE_TIME) {
+		count = 0;
+		return 0;
+	} // The process has been running correctly
+
+	if(count == AUDIO_MAX_RESTARTS)
+		return -1;
+
+	return AUDIO_RESTART_DELAY << count++;
+}
+
+/**
+ \brief Return the class of a message
+
+ \param messageID The message ID
+ \return The message class, one of the AUDIO_CLASS constants
+ */
+int AudioDispatcher::getClass(int messageID) {
+	switch(messageID) {
+		case TTS_SYSTEM_RESTARTED:
+		case TTS_POWER_OFF:
+		case TTS_SHUTDOWN:
+			return AUDIO_CLASS_POWER;
+
+		case TTS_VOICE_ACTIVE:
+		case TTS_MUTED:
+			return AUDIO_CLASS_VOICE;
+
+		case TTS_INFORMATION:
+		case TTS_TESTING:
+		case TTS_TESTING_END:
+		case TTS_SYSTEM_READY:
+			return AUDIO_CLASS_SYSTEM;
+
+		default:
+			return AUDIO_CLASS_PROBE;
+	} // Message classes
+}
+
+/**
+ \brief Event loop callback for the command pipe
+
+ The received message IDs are queued. When the pipe is closed the worker ends.
+ */
+void AudioDispatcher::commandEvent(int fd, uint32_t events, void* context) {
+	AudioDispatcher* self = (AudioDispatcher*)context;
+	int messageID;
+	ssize_t received;
+
+	received = read(fd, &messageID, sizeof(messageID));
+	if(received == sizeof(messageID)) {
+		self->enqueue(messageID);
+	} // Message received
+	else if( (received == 0) || ((received == -1) && (errno != EINTR)) ) {
+		self->loop.stop();
+	} // The controller closed the pipe
+}
+
+/**
+ \brief Event loop callback for the SIGCHLD signalfd
+
+ All the ended child processes are reaped. When the player ends the next
+ waiting message is played. When the ssh master connection ends its readiness
+ check is stopped and the time it can be opened again is set.
+ */
+void AudioDispatcher::childEvent(int fd, uint32_t events, void* context) {
+	AudioDispatcher* self = (AudioDispatcher*)context;
+	struct signalfd_siginfo info;
+	pid_t pid;
+	int delay;
+
+	while(read(fd, &info, sizeof(info)) == sizeof(info))
+		;
+
+	while( (pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+		if(pid == self->playerPid) {
+			self->stopStream();
+			self->playerPid = -1;
+		} // Player ended
+		else if(pid == self->connectionPid) {
+			self->connectionPid = -1;
+			self->report(false);
+			self->stopConnectTimer();
+			delay = getBackoffDelay(self->connectionTime, self->reconnects);
+			self->reconnectTime = delay == -1 ?
+					AUDIO_NO_RECONNECT : EventLoop::currentTime() + delay;
+		} // Connection closed
+	} // Reap the ended processes
+
+	self->playNext();
+}
+
+/**
+ \brief Event loop callback for the player input pipe
+
+ Sends to the player as much audio data as the pipe accepts. When all the data
+ is sent, or the player does not read it anymore, the pipe is closed.
+ */
+void AudioDispatcher::streamEvent(int fd, uint32_t events, void* context) {
+	AudioDispatcher* self = (AudioDispatcher*)context;
+	ssize_t sent;
+
+	sent = write(fd, self->streamData, self->streamLength);
+	if(sent > 0) {
+		self->streamData += sent;
+		self->streamLength -= sent;
+		if(self->streamLength == 0)
+			self->stopStream();
+	} // Data sent
+	else if( (sent == -1) && (errno != EAGAIN) && (errno != EINTR) ) {
+		self->stopStream();
+	} // The player closed the pipe
+}
+
+/**
+ \brief Event loop callback for the connection readiness check timer
+
+ The ssh master connection creates the control socket when it is established.
+ */
+void AudioDispatcher::connectEvent(int fd, uint32_t events, void* context) {
+	AudioDispatcher* self = (AudioDispatcher*)context;
+	struct stat socketStatus;
+
+	if(stat(AUDIO_CONTROL_SOCKET, &socketStatus) == 0) {
+		self->report(true);
+		self->stopConnectTimer();
+	} // Connection established
+}
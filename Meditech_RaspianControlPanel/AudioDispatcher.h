@@ -0,0 +1,154 @@
+/**
+\file AudioDispatcher.h
+\brief Long-lived process playing the voice messages on the remote player.
+
+ The controller does not launch a new process for every voice message: a worker
+ process is created once at startup and receives the message IDs through a pipe.
+ The worker opens a single ssh master connection to the remote player and every
+ message is played through the shared connection (ssh ControlMaster), so no ssh
+ handshake is needed when a key is pressed. The audio data is read from the
+ voice messages pack (see AssetPack.h), mapped once when the worker starts, and
+ is streamed to the player standard input through the ssh connection, so the
+ remote player does not need access to the audio files. The encoded messages
+ are decoded on the remote host by the standalone decoder (see AudioDecoder.cpp).
+ The messages are played one at a time from a prioritized queue:
+
+ - every message belongs to a class (see the AUDIO_CLASS constants); a new
+   message replaces the waiting message of the same class and interrupts the
+   playing one, as it reports a more recent status
+ - a message repeated within AUDIO_DEDUPE_WINDOW is ignored, also when other
+   messages have been accepted in the meantime
+ - the power messages are queued before the other messages and interrupt the
+   playing message
+
+ The worker is driven by its own EventLoop watching the command pipe, the
+ player input pipe and a signalfd receiving SIGCHLD, so the player processes
+ are reaped as soon as they end and the next message starts. When the pack is
+ mapped and the ssh connection is established the worker writes
+ AUDIO_STATUS_READY (or AUDIO_STATUS_FAILED) on the status pipe, so the
+ controller knows when the voice messages can be played. When the controller
+ ends the pipe is closed and the worker exits.
+ */
+
+#include "AssetPack.h"
+#include "EventLoop.h"
+#include "MessageStrings.h"
+#include <sys/types.h>
+
+#ifndef AUDIODISPATCHER_H
+#define	AUDIODISPATCHER_H
+
+//! Max number of messages waiting to be played
+#define AUDIO_QUEUE_SIZE 8
+
+//! Interval of the ssh connection readiness check (ms)
+#define AUDIO_CONNECT_POLL 50
+
+//! Delay of the first restart of a worker ended too early (ms). The delay is
+//! doubled at every consecutive restart
+#define AUDIO_RESTART_DELAY 500
+
+//! Max number of consecutive restarts of a worker ended too early
+#define AUDIO_MAX_RESTARTS 5
+
+//! A worker running at least this time is restarted with no delay (ms)
+#define AUDIO_STABLE_TIME 60000
+
+//! Accepted time of a message never played
+#define AUDIO_NEVER_ACCEPTED -1
+
+//! Reconnection time when the ssh master connection is no more opened
+#define AUDIO_NO_RECONNECT -1
+
+//! The open descriptors of the process, closed in the worker
+#define AUDIO_FD_DIR "/proc/self/fd"
+
+//! Status sent by the worker when the messages can be played
+#define AUDIO_STATUS_READY 'R'
+
+//! Status sent by the worker when the messages can't be played
+#define AUDIO_STATUS_FAILED 'F'
+
+class AudioDispatcher {
+public:
+	AudioDispatcher();
+	virtual ~AudioDispatcher();
+	bool start();
+	bool play(int messageID);
+	bool hasEnded();
+	void stop();
+	pid_t getPid();
+	int getStatusFd();
+	int getRestartDelay();
+
+	static void unblockSignals();
+private:
+	//! Controller side: the write end of the command pipe
+	int commandPipe;
+	//! Controller side: the worker process id
+	pid_t workerPid;
+	//! Controller side: the read end of the status pipe
+	int statusFd;
+	//! Controller side: the time the worker has been started (ms)
+	long startTime;
+	//! Controller side: number of consecutive restarts of a worker ended too early
+	int restarts;
+	//! Controller side: the worker closed the command pipe
+	bool isEnded;
+
+	//! Worker side: the event loop
+	EventLoop loop;
+	//! Worker side: the SIGCHLD signalfd
+	int signalFd;
+	//! Worker side: the write end of the status pipe
+	int reportFd;
+	//! Worker side: the connection readiness check timer or -1
+	int connectTimer;
+	//! Worker side: the player process id or -1 if no message is playing
+	pid_t playerPid;
+	//! Worker side: the ssh master connection process id or -1
+	pid_t connectionPid;
+	//! Worker side: the time the ssh master connection has been opened (ms)
+	long connectionTime;
+	//! Worker side: number of consecutive reconnections of a connection closed
+	//! too early
+	int reconnects;
+	//! Worker side: the time the connection can be opened again (ms) or
+	//! AUDIO_NO_RECONNECT
+	long reconnectTime;
+	//! Worker side: the messages waiting to be played, in playing order
+	int queue[AUDIO_QUEUE_SIZE];
+	//! Worker side: number of waiting messages
+	int count;
+	//! Worker side: the class of the playing message
+	int playingClass;
+	//! Worker side: the time every message has been accepted the last time (ms),
+	//! or AUDIO_NEVER_ACCEPTED
+	long acceptedTime[TTS_MAX_MESSAGES];
+	//! Worker side: the voice messages pack
+	AssetPack assets;
+	//! Worker side: the player input pipe or -1 when the data is sent
+	int streamFd;
+	//! Worker side: the audio data still to be sent to the player
+	const uint8_t* streamData;
+	//! Worker side: the length of the audio data still to be sent
+	uint32_t streamLength;
+
+	void run(int pipeFd);
+	void closeInherited(int pipeFd, int reportPipe);
+	void report(bool isReady);
+	void enqueue(int messageID);
+	void playNext();
+	void openConnection();
+	pid_t spawnPlayer(int messageID);
+	void stopStream();
+	void stopConnectTimer();
+	static int getBackoffDelay(long startedTime, int& count);
+	static int getClass(int messageID);
+	static void commandEvent(int fd, uint32_t events, void* context);
+	static void childEvent(int fd, uint32_t events, void* context);
+	static void streamEvent(int fd, uint32_t events, void* context);
+	static void connectEvent(int fd, uint32_t events, void* context);
+};
+
+#endif	/* AUDIODISPATCHER_H */
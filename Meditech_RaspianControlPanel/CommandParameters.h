@@ -39,6 +39,38 @@
 //! String delimiter
 #define STRING_DELIMITER '"'
 
+/**
+  \brief Sequence ID marker
+  
+  A command line can start with the sequence ID marker followed by the
+  PARM_SEQUENCE_LEN digits of the sequence ID. The board starts the responses
+  to the command line with the same sequence ID, so the master can match
+  every response with its request while more commands are waiting for
+  the response.
+  
+  Example: #07@L;00;... is acknowledged by #07:L:0
+  */
+#define SEQUENCE_MARKER '#'
+
+//! Fixed sequence ID characters length.
+//! Should be left zero filled in the form 00
+#define PARM_SEQUENCE_LEN 2
+
+//! Number of the sequence IDs (from 0 to MAX_SEQUENCE - 1)
+#define MAX_SEQUENCE 100
+
+//! Sequence ID of the commands sent without sequence ID
+#define NO_SEQUENCE -1
+
+//! Command line terminator. The control panel board readline() starts
+//! parsing the received line when this character arrives.
+#define CMD_TERMINATOR '\r'
+
+//! The max length of a command frame sent to the control panel. The largest
+//! frame is a template command with six fields of CMD_MSGLEN characters plus
+//! the separators, the delimiters and the terminator (144 bytes)
+#define MAX_FRAME_LEN 160
+
 //! Fixed field ID characters length.
 //! Should be left zero filled in the form 00
 #define PARM_FIELDID_LEN 2
@@ -55,6 +87,9 @@
 //! Should be left zero filled in the form 0000000.000
 #define PARM_FLOAT_LEN 11
 
+//! Number of decimal digits of the fixed float characters
+#define PARM_FLOAT_DECIMALS 3
+
 //! Fixed boolean character length. 
 //! Should be left zero filled in the form 0 (or 1)
 #define PARM_BOOL_LEN 1
@@ -97,8 +132,22 @@ typedef struct parseCommand {
   float booleanValue;
 } command;
 
+/**
+  \typedef commandFrame
+  \brief Command frame ready to be sent
+  
+  The frame holds the encoded command bytes including the final CMD_TERMINATOR.
+  The frame is not null terminated: only the first length bytes should be sent.
+*/
+typedef struct CommandFrame {
+  //! The encoded command bytes
+  char data[MAX_FRAME_LEN];
+  //! The number of valid bytes in the frame
+  int length;
+} commandFrame;
+
 //! The length  of CMD_CHARACTERS + 1
-#define CMD_CHARLEN 10
+#define CMD_CHARLEN 11
 
 /**
   \brief command: Enable/disable a probe
@@ -177,6 +226,39 @@ typedef struct parseCommand {
   */
 #define CMD_LCDTEMPLATE 'L'
 
+/**
+  \brief command: Update a field of the active LCD template
+  
+  description: replace the string of a single field of the template shown by the
+  last CMD_LCDTEMPLATE command. Only the field characters are redrawn: the display
+  is not cleared and the other fields are not sent again. The characters of the
+  previous string exceeding the new one are blanked.
+  name: F \n
+  usage: F;<Field ID>;"<Field String>" \n
+  direction: receive\n
+  example: F;02;"72" \n
+  Show 72 in the spot value field of the heartbeat template
+  
+  \note The command fails with COMMAND_WRONG_TEMPLATE if no template is shown
+  */
+#define CMD_FIELD 'F'
+
+/**
+  \brief command: binary link protocol request
+  
+  description: the master asks if the binary framed protocol (see LinkProtocol.h)
+  is supported. The board accepts the binary frames at any time, recognised by the
+  link delimiter, and answers every binary command with a binary response. The
+  master starts sending binary frames only after this command has been acknowledged
+  with no errors, so the boards not supporting the binary protocol keep working
+  with the ASCII commands.
+  name: B \n
+  usage: B;<(bool)enable> \n
+  direction: receive\n
+  example: B;1 \n
+  */
+#define CMD_BINARY 'B'
+
 /**
   \brief command: info
   
@@ -209,7 +291,8 @@ typedef struct parseCommand {
   name: r \n
   usage: r;<parameter ID> \n
   direction: send\n
-  \todo Should be implemented in the RPI master before
+  The parameter ID of a template field is <template ID> * MAX_FIELDS + <field ID>
+  and the master answers with the CMD_REQUEST command.
   \todo Update the definitino in the ChipKit class header accordingly.
   */
 #define CMD_MASTER_REQUEST 'r'
@@ -287,5 +370,9 @@ typedef struct parseCommand {
 //! Command string separator used in the commandReturn() method
 #define RESPONSE_SEPARATOR ":"
 
+//! Response of the board to the CMD_BINARY command when the binary
+//! protocol is supported
+#define LINK_BINARY_ACK ":B:0"
+
 #endif
 
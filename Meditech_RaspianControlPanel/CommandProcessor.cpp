@@ -10,8 +10,33 @@
 
 /**
  \brief Constructor method
+
+ Loads the default fields content of all the templates and the template
+ commands cache. The default template commands are compile-time constants
+ so they are copied without formatting. The binary version of every template
+ command is built too, so the protocol can be switched at any time.
  */
 CommandProcessor::CommandProcessor() {
+	emptyFrame.length = 0;
+	fieldFrame.length = 0;
+	enableFrame.length = 0;
+	linkModeFrame.length = 0;
+	sequenceFrame.length = 0;
+	parameterFrame.length = 0;
+	requestedTemplate = MIRROR_UNKNOWN;
+	binaryMode = false;
+
+	for(int t = 0; t < MAX_TEMPLATES; t++) {
+		templateNumFields[t] = mTemplates.createDisplay(t);
+		for(int j = 0; j < templateNumFields[t]; j++) {
+			strncpy(templateValues[t][j], mTemplates.getField(j), CMD_MSGLEN);
+			templateValues[t][j][CMD_MSGLEN] = CMD_NULLCHAR;
+		} // Load the template default fields
+		templateFrames[t].length = mTemplates.getFrameLength();
+		memcpy(templateFrames[t].data, mTemplates.getFrame(), templateFrames[t].length);
+		buildBinaryFrame(t);
+		isFrameStale[t] = false;
+	} // Create all the templates
 }
 
 /**
@@ -21,102 +46,759 @@ CommandProcessor::~CommandProcessor() {
 }
 
 /**
- \brief Generate a template creation command
+ \brief Return a template creation command
 
- This method based on the requested templateID create the command string ready to
- be sent to the control panel board.
+ The template commands are built when the class is created and rebuilt only when
+ a field has changed, so this method usually returns the cached frame without
+ formatting.
+ When the binary mode is set the binary frame of the template is returned.
+ The command should be sent to the board: when the board acknowledges it the
+ template becomes the active template, whose fields are then updated with the
+ field commands returned by buildFieldUpdate().
  
  \param templateID The id of the requested template
- \return The string with the full command.
+ \return The frame with the full command. The reference remains valid for the
+ class instance life. If the template ID is invalid or the board already shows
+ the template with the same fields an empty frame is returned.
  */
-char* CommandProcessor::buildCommandDisplayTemplate(int templateID) {
-	//! The full command string
-	char command[MAX_CMD_LEN];
-	int cPos = 0;	///< character position counter in the command string
+const commandFrame& CommandProcessor::buildCommandDisplayTemplate(int templateID) {
+	if( (templateID < 0) || (templateID >= MAX_TEMPLATES) )
+		return emptyFrame;
+
+	requestedTemplate = templateID;
+	if(mirror.isTemplateShown(templateID, templateValues[templateID], templateNumFields[templateID]))
+		return emptyFrame;
+
+	if(isFrameStale[templateID]) {
+		buildTemplateFrame(templateID);
+		buildBinaryFrame(templateID);
+		isFrameStale[templateID] = false;
+	} // Fields changed since the last template command
+
+	if(binaryMode)
+		return binaryFrames[templateID];
+
+	return templateFrames[templateID];
+}
+
+/**
+ \brief Update the content of a template field
+
+ Only the new content is stored: the template cached commands are rebuilt when
+ the template is requested, so a field updated many times between two template
+ commands is serialized once. Strings longer than CMD_MSGLEN are truncated.
+ The changed fields of the active template are sent by buildFieldUpdate(), the
+ fields of the other templates are sent with their next template command.
+ 
+ \param templateID The id of the template
+ \param fieldID The field to update
+ \param val The new field string
+ \return true if the field has been changed, else false
+ */
+bool CommandProcessor::updateDisplay(int templateID, int fieldID, const char* val) {
+	if( (templateID < 0) || (templateID >= MAX_TEMPLATES) )
+		return false;
+	if( (fieldID < 0) || (fieldID >= templateNumFields[templateID]) )
+		return false;
+	if(strncmp(templateValues[templateID][fieldID], val, CMD_MSGLEN) == 0)
+		return false;
+
+	strncpy(templateValues[templateID][fieldID], val, CMD_MSGLEN);
+	templateValues[templateID][fieldID][CMD_MSGLEN] = CMD_NULLCHAR;
+	isFrameStale[templateID] = true;
+
+	return true;
+}
+
+/**
+ \brief Build the update command of a field of the active template
+
+ The field is compared with the content shown by the board, so it is sent only
+ if it has changed since the last acknowledged command, with its latest value.
+ The display is not redrawn (see CMD_FIELD).
+ 
+ \param fieldID The field of the active template
+ \return The field update command, in the current protocol. The frame remains
+ valid until the next call. If the board shows the field content or the active
+ template is not known an empty frame is returned.
+ */
+const commandFrame& CommandProcessor::buildFieldUpdate(int fieldID) {
+	int templateID = mirror.getTemplate();
+
+	if( (templateID < 0) || (templateID >= MAX_TEMPLATES) )
+		return emptyFrame;
+	if( (fieldID < 0) || (fieldID >= templateNumFields[templateID]) )
+		return emptyFrame;
+	if(mirror.isFieldShown(fieldID, templateValues[templateID][fieldID]))
+		return emptyFrame;
+
+	buildFieldFrame(templateID, fieldID);
+	return fieldFrame;
+}
+
+/**
+ \brief Build the command requesting the binary protocol to the board
+ 
+ The command is always sent as ASCII string, as the board may not support the
+ binary protocol. The binary mode should be set only after the board ack.
+ 
+ \param enable true to request the binary protocol, false to return to ASCII
+ \return The frame with the full command
+ */
+const commandFrame& CommandProcessor::buildLinkModeCommand(bool enable) {
+	int cPos = 0;
 	
-	// Generates the desired template fields and parameters.
-	mTemplates.createDisplay(templateID);
+	linkModeFrame.data[cPos++] = CMD_SEPARATOR;
+	linkModeFrame.data[cPos++] = CMD_BINARY;
+	linkModeFrame.data[cPos++] = FIELD_SEPARATOR;
+	encodeBool(linkModeFrame.data + cPos, enable);
+	cPos += PARM_BOOL_LEN;
+	linkModeFrame.data[cPos++] = CMD_TERMINATOR;
+	linkModeFrame.length = cPos;
+
+	return linkModeFrame;
+}
+
+/**
+ \brief Build the command enabling or disabling a probe on the board
+ 
+ \param probe The probe subcommand, e.g. S_STETHOSCOPE
+ \param enable The requested probe status
+ \return The frame with the full command, in the current protocol. The frame
+ remains valid until the next call. If the probe is already in the requested
+ status an empty frame is returned.
+ */
+const commandFrame& CommandProcessor::buildEnableCommand(char probe, bool enable) {
+	LinkFrame frame;
+	int frameLength;
+	int cPos = 0;
+	
+	if(mirror.isProbeSet(probe, enable))
+		return emptyFrame;
 	
-	// Now the tParams calls instance contains already defined the field settings
-	// and parameters to build the command.
-	command[cPos++] = CMD_SEPARATOR;		// start with command 
-	command[cPos++] = CMD_LCDTEMPLATE;		// Add the command character
-	command[cPos++] = FIELD_SEPARATOR;		// Add the field separator
+	if(binaryMode) {
+		frame.begin(CMD_ENABLE, LINK_NO_SEQUENCE);
+		frame.addUInt8((uint8_t)probe);
+		frame.addBool(enable);
+		frameLength = frame.encode((uint8_t*)enableFrame.data, MAX_FRAME_LEN);
+		enableFrame.length = frameLength > 0 ? frameLength : 0;
+		return enableFrame;
+	} // Binary frame
+	
+	enableFrame.data[cPos++] = CMD_SEPARATOR;
+	enableFrame.data[cPos++] = CMD_ENABLE;
+	enableFrame.data[cPos++] = FIELD_SEPARATOR;
+	enableFrame.data[cPos++] = probe;
+	enableFrame.data[cPos++] = FIELD_SEPARATOR;
+	encodeBool(enableFrame.data + cPos, enable);
+	cPos += PARM_BOOL_LEN;
+	enableFrame.data[cPos++] = CMD_TERMINATOR;
+	enableFrame.length = cPos;
+	
+	return enableFrame;
+}
+
+/**
+ \brief Forget the display state of the board
+ 
+ Should be called when the board may have lost its state or a command changing
+ it has not been executed, e.g. when the board does not respond, a command is
+ discarded or refused, so the next commands are sent in full.
+ */
+void CommandProcessor::invalidateMirror() {
+	mirror.invalidate();
+}
+
+/**
+ \brief Apply to the mirror the display change of an acknowledged command
+ 
+ \param sequence The sequence ID of a COMMAND_OK response matching a command
+ waiting for the response
+ */
+void CommandProcessor::commitMirror(int sequence) {
+	mirror.commit(sequence);
+}
+
+/**
+ \brief Return the template shown by the board or MIRROR_UNKNOWN
+ */
+int CommandProcessor::getActiveTemplate() {
+	return mirror.getTemplate();
+}
+
+/**
+ \brief Return the last requested template or MIRROR_UNKNOWN
+ 
+ The template should be sent again when the template shown by the board is not
+ known.
+ */
+int CommandProcessor::getRequestedTemplate() {
+	return requestedTemplate;
+}
+
+/**
+ \brief Tag a command with a sequence ID
+ 
+ The ASCII commands are prefixed with the SEQUENCE_MARKER and the sequence ID
+ digits. The binary frames are decoded, the sequence ID is set in the frame
+ header and the frame is encoded again as the CRC includes the header.
+ The display change of the command is recorded with the sequence ID and applied
+ to the mirror by commitMirror() when the board acknowledges the command.
+ 
+ \param command The command frame, ASCII or binary
+ \param sequence The sequence ID, from 0 to MAX_SEQUENCE - 1
+ \return The tagged command frame. The frame remains valid until the next
+ call. If the command can't be tagged an empty frame is returned.
+ */
+const commandFrame& CommandProcessor::stampSequence(const commandFrame& command, int sequence) {
+	LinkFrame frame;
+	mirrorChange change;
+	int frameLength;
+	
+	change.type = CMD_NULLCHAR;
+	
+	if( (command.length < 2) || (sequence < 0) || (sequence >= MAX_SEQUENCE) )
+		return emptyFrame;
+	
+	if(command.data[0] == LINK_DELIMITER) {
+		if(!frame.decode((const uint8_t*)command.data + 1, command.length - 2))
+			return emptyFrame;
+		decodeBinaryChange(frame, change);
+		frame.setSequence((uint8_t)sequence);
+		frameLength = frame.encode((uint8_t*)sequenceFrame.data, MAX_FRAME_LEN);
+		if(frameLength <= 0)
+			return emptyFrame;
+		sequenceFrame.length = frameLength;
+	} // Binary frame
+	else {
+		if(command.length + PARM_SEQUENCE_LEN + 1 > MAX_FRAME_LEN)
+			return emptyFrame;
+		sequenceFrame.data[0] = SEQUENCE_MARKER;
+		encodeField(sequenceFrame.data + 1, sequence, PARM_SEQUENCE_LEN);
+		memcpy(sequenceFrame.data + PARM_SEQUENCE_LEN + 1, command.data, command.length);
+		sequenceFrame.length = command.length + PARM_SEQUENCE_LEN + 1;
+		decodeChange(command, change);
+	} // ASCII command
+	
+	mirror.expect(sequence, change);
+	return sequenceFrame;
+}
+
+/**
+ \brief Build the answer to a parameter request of the board
+ 
+ The parameters are the template fields: the parameter ID is
+ <template ID> * MAX_FIELDS + <field ID> and the value is the current
+ content of the field.
+ 
+ \param parameterID The requested parameter ID
+ \return The CMD_REQUEST command with the parameter value, in the current
+ protocol. If the parameter ID is invalid an empty frame is returned.
+ */
+const commandFrame& CommandProcessor::buildParameterCommand(int parameterID) {
+	LinkFrame frame;
+	int templateID = parameterID / MAX_FIELDS;
+	int fieldID = parameterID % MAX_FIELDS;
+	const char* value;
+	int frameLength;
+	int cPos = 0;
+	
+	if( (parameterID < 0) || (templateID >= MAX_TEMPLATES) ||
+			(fieldID >= templateNumFields[templateID]) )
+		return emptyFrame;
+	value = templateValues[templateID][fieldID];
+	
+	if(binaryMode) {
+		frame.begin(CMD_REQUEST, LINK_NO_SEQUENCE);
+		frame.addInt16((int16_t)parameterID);
+		frame.addString(value);
+		frameLength = frame.encode((uint8_t*)parameterFrame.data, MAX_FRAME_LEN);
+		parameterFrame.length = frameLength > 0 ? frameLength : 0;
+		return parameterFrame;
+	} // Binary frame
+	
+	parameterFrame.data[cPos++] = CMD_SEPARATOR;
+	parameterFrame.data[cPos++] = CMD_REQUEST;
+	parameterFrame.data[cPos++] = FIELD_SEPARATOR;
+	encodeInteger(parameterFrame.data + cPos, parameterID);
+	cPos += PARM_INTEGER_LEN;
+	parameterFrame.data[cPos++] = FIELD_SEPARATOR;
+	parameterFrame.data[cPos++] = STRING_DELIMITER;
+	for(int k = 0; value[k] != CMD_NULLCHAR; k++)
+		parameterFrame.data[cPos++] = value[k];
+	parameterFrame.data[cPos++] = STRING_DELIMITER;
+	parameterFrame.data[cPos++] = CMD_TERMINATOR;
+	parameterFrame.length = cPos;
+	
+	return parameterFrame;
+}
+
+/**
+ \brief Set the protocol of the commands returned by the class
+ 
+ \param enable true to return the binary frames, false for the ASCII commands
+ */
+void CommandProcessor::setBinaryMode(bool enable) {
+	binaryMode = enable;
+}
+
+/**
+ \brief Check if the binary frames are returned
+ */
+bool CommandProcessor::isBinaryMode() {
+	return binaryMode;
+}
+
+/**
+ \brief Serialize a template creation command in the cache
+
+ The frame ends with the CMD_TERMINATOR character expected by the board and
+ its length is the number of bytes to send.
+ 
+ \param templateID The id of the template to build
+ */
+void CommandProcessor::buildTemplateFrame(int templateID) {
+	//! The full command frame
+	commandFrame& command = templateFrames[templateID];
+	int cPos = 0;	///< character position counter in the command string
+	
+	command.data[cPos++] = CMD_SEPARATOR;		// start with command 
+	command.data[cPos++] = CMD_LCDTEMPLATE;		// Add the command character
+	command.data[cPos++] = FIELD_SEPARATOR;		// Add the field separator
 	// Convert the field ID integer to the proper character sequence
-	std::string temp = intToString(templateID, PARM_FIELDID_LEN);
-	for(int k = 0; k < temp.size(); k++)
-		command[cPos++] = temp.at(k);
+	encodeField(command.data + cPos, templateID, PARM_FIELDID_LEN);
+	cPos += PARM_FIELDID_LEN;
 	
 	// Loop creating fields
-	for(int j = 0; j < mTemplates.getNumFields(); j++) {
-		command[cPos++] = FIELD_SEPARATOR; // Add the field separator
-		command[cPos++] = STRING_DELIMITER; // Add the left string delimiter
+	for(int j = 0; j < templateNumFields[templateID]; j++) {
+		command.data[cPos++] = FIELD_SEPARATOR; // Add the field separator
+		command.data[cPos++] = STRING_DELIMITER; // Add the left string delimiter
 		// Load the field characters in the array
-		char* s = (char *)mTemplates.getField(j);
-		for(int k = 0; k < strlen(s); k++)
-			command[cPos++] = s[k];
+		const char* s = templateValues[templateID][j];
+		for(int k = 0; s[k] != CMD_NULLCHAR; k++)
+			command.data[cPos++] = s[k];
 
-		command[cPos++] = STRING_DELIMITER; // Add the right string delimiter
+		command.data[cPos++] = STRING_DELIMITER; // Add the right string delimiter
 	} // End of command build
 	
-	command[cPos] = CMD_NULLCHAR;
-	return command;
+	command.data[cPos++] = CMD_TERMINATOR;
+	command.length = cPos;
+}
+
+/**
+ \brief Encode a template creation command with the binary protocol
+ 
+ The frame type is the CMD_LCDTEMPLATE character, followed by the template ID
+ as unsigned 8 bits integer and the template fields as strings.
+ 
+ \param templateID The id of the template to build
+ */
+void CommandProcessor::buildBinaryFrame(int templateID) {
+	LinkFrame frame;
+	int frameLength;
+	
+	frame.begin(CMD_LCDTEMPLATE, LINK_NO_SEQUENCE);
+	frame.addUInt8((uint8_t)templateID);
+	for(int j = 0; j < templateNumFields[templateID]; j++)
+		frame.addString(templateValues[templateID][j]);
+	
+	frameLength = frame.encode((uint8_t*)binaryFrames[templateID].data, MAX_FRAME_LEN);
+	binaryFrames[templateID].length = frameLength > 0 ? frameLength : 0;
 }
 
 /**
- \brief Convert an Integer to string
+ \brief Serialize the update command of a field of the active template
+
+ The command is in the ASCII format @F;<field ID>;"<string>" or, when the
+ binary mode is set, a CMD_FIELD frame with the field ID as unsigned 8 bits
+ integer and the field string.
  
- \param i The integer value to convert
- \return The converted string
+ \param templateID The active template
+ \param fieldID The field to send
  */
-std::string CommandProcessor::intToString(int i) {
-	std::ostringstream ss;
-	ss << i;
+void CommandProcessor::buildFieldFrame(int templateID, int fieldID) {
+	LinkFrame frame;
+	const char* value = templateValues[templateID][fieldID];
+	int frameLength;
+	int cPos = 0;
 
-	return ss.str();
+	if(binaryMode) {
+		frame.begin(CMD_FIELD, LINK_NO_SEQUENCE);
+		frame.addUInt8((uint8_t)fieldID);
+		frame.addString(value);
+		frameLength = frame.encode((uint8_t*)fieldFrame.data, MAX_FRAME_LEN);
+		fieldFrame.length = frameLength > 0 ? frameLength : 0;
+		return;
+	} // Binary frame
+
+	fieldFrame.data[cPos++] = CMD_SEPARATOR;
+	fieldFrame.data[cPos++] = CMD_FIELD;
+	fieldFrame.data[cPos++] = FIELD_SEPARATOR;
+	encodeField(fieldFrame.data + cPos, fieldID, PARM_FIELDID_LEN);
+	cPos += PARM_FIELDID_LEN;
+	fieldFrame.data[cPos++] = FIELD_SEPARATOR;
+	fieldFrame.data[cPos++] = STRING_DELIMITER;
+	for(int k = 0; value[k] != CMD_NULLCHAR; k++)
+		fieldFrame.data[cPos++] = value[k];
+	fieldFrame.data[cPos++] = STRING_DELIMITER;
+	fieldFrame.data[cPos++] = CMD_TERMINATOR;
+	fieldFrame.length = cPos;
 }
 
 /**
- \brief Convert an Integer to string of fixed length
+ \brief Decode the display change of an ASCII command built by the class
+ 
+ Only the template, field update and probe enable commands change the display,
+ the change type of the other commands is not set.
  
- \param i The integer value to convert
- \param l The requested integer length
- \return The converted string or a null string if the resulting integer
- conversion is larger than the requested length. If the string is shorter
- than the requested length it is left-filled with zeroes.
+ \param command The ASCII command, without the sequence ID
+ \param change The decoded display change
  */
-std::string CommandProcessor::intToString(int i, int l) {
-	//! The bare converted number
-	std::string temp = intToString(i);
-	
-	if(temp.size() > l)
-		return "";	// Number too big to fit!
-	
-	if(temp.size() < l) {
-		std::string temp2 = "";
-		// Left fill the string
-		for(int j = 0; j < (l - temp.size()); j++)
-			temp2.append("0");
-		// Add the converted number;
-		temp2.append(temp);
-		return temp2;
-	} // when the number is smaller
-	
-	// The number is of the requested length
-	return temp;
+void CommandProcessor::decodeChange(const commandFrame& command, mirrorChange& change) {
+	const char* data = command.data;
+	int cPos = 3;
+	long value;
+	bool enable;
+
+	if( (command.length < 6) || (data[0] != CMD_SEPARATOR) || (data[2] != FIELD_SEPARATOR) )
+		return;
+
+	switch(data[1]) {
+		case CMD_LCDTEMPLATE:
+		case CMD_FIELD:
+			if(!decodeField(data + cPos, PARM_FIELDID_LEN, value))
+				return;
+			cPos += PARM_FIELDID_LEN;
+			change.fieldCount = 0;
+			while( (cPos < command.length) && (data[cPos] == FIELD_SEPARATOR) ) {
+				if(change.fieldCount == MAX_FIELDS)
+					return;
+				cPos = decodeString(command, cPos + 1, change.values[change.fieldCount]);
+				if(cPos < 0)
+					return;
+				change.fieldCount++;
+			} // Read the field strings
+			if( (data[1] == CMD_FIELD) && (change.fieldCount != 1) )
+				return;
+			change.id = (int)value;
+			break;
+		case CMD_ENABLE:
+			if( (data[cPos + 1] != FIELD_SEPARATOR) || !decodeBool(data + cPos + 2, enable) )
+				return;
+			change.id = data[cPos];
+			change.enable = enable;
+			break;
+		default:
+			return;
+	} // Display commands
+
+	change.type = data[1];
+}
+
+/**
+ \brief Decode the display change of a binary frame built by the class
+ 
+ \param frame The decoded frame, with the read position at the first field
+ \param change The decoded display change
+ */
+void CommandProcessor::decodeBinaryChange(LinkFrame& frame, mirrorChange& change) {
+	uint8_t id;
+	bool enable;
+
+	if(!frame.readUInt8(id))
+		return;
+
+	switch(frame.getType()) {
+		case CMD_LCDTEMPLATE:
+		case CMD_FIELD:
+			change.fieldCount = 0;
+			while(!frame.isEnd()) {
+				if( (change.fieldCount == MAX_FIELDS) ||
+						!frame.readString(change.values[change.fieldCount], CMD_MSGLEN + 1) )
+					return;
+				change.fieldCount++;
+			} // Read the field strings
+			if( (frame.getType() == CMD_FIELD) && (change.fieldCount != 1) )
+				return;
+			break;
+		case CMD_ENABLE:
+			if(!frame.readBool(enable))
+				return;
+			change.enable = enable;
+			break;
+		default:
+			return;
+	} // Display commands
+
+	change.id = id;
+	change.type = frame.getType();
 }
 
 /**
- \breif Convert a string to integer
+ \brief Read a quoted string of an ASCII command
  
- \param s The string to convert
- \return The integer conversion result or 0 if the string is not numeric
+ \param command The ASCII command
+ \param position The position of the left STRING_DELIMITER
+ \param value The string, up to CMD_MSGLEN characters plus the null terminator
+ \return The position after the right STRING_DELIMITER or -1 if the string is
+ malformed
  */
-int CommandProcessor::stringToInt(std::string &s) {
-	int result;
-	std::istringstream ss(s);
+int CommandProcessor::decodeString(const commandFrame& command, int position, char* value) {
+	int k = 0;
+
+	if( (position >= command.length) || (command.data[position] != STRING_DELIMITER) )
+		return -1;
+
+	for(position++; position < command.length; position++) {
+		if(command.data[position] == STRING_DELIMITER) {
+			value[k] = CMD_NULLCHAR;
+			return position + 1;
+		} // End of the string
+		if(k == CMD_MSGLEN)
+			return -1;
+		value[k++] = command.data[position];
+	} // Copy the characters
 
-	return ss >> result ? result : 0;
+	return -1;
 }
 
+/**
+ \brief Encode an integer in a fixed width field
+ 
+ The number is written directly in the caller buffer, left-filled with zeroes.
+ Negative numbers start with the minus sign, that is part of the field width.
+ The buffer is not null terminated.
+ 
+ \param buffer The destination buffer, at least width characters long
+ \param value The integer value to convert
+ \param width The field width in characters
+ \return false if the number does not fit in the field width
+ */
+bool CommandProcessor::encodeField(char* buffer, long value, int width) {
+	if(width <= 0)
+		return false;
+
+	if(value < 0) {
+		buffer[0] = '-';
+		return encodeDigits(buffer + 1, (unsigned long)(-(value + 1)) + 1, width - 1);
+	} // Negative number
 
+	return encodeDigits(buffer, (unsigned long)value, width);
+}
+
+/**
+ \brief Encode an integer in a PARM_INTEGER_LEN field
+ */
+bool CommandProcessor::encodeInteger(char* buffer, int value) {
+	return encodeField(buffer, value, PARM_INTEGER_LEN);
+}
+
+/**
+ \brief Encode a long integer in a PARM_LONGINT_LEN field
+ */
+bool CommandProcessor::encodeLong(char* buffer, long value) {
+	return encodeField(buffer, value, PARM_LONGINT_LEN);
+}
+
+/**
+ \brief Encode a floating point number in a PARM_FLOAT_LEN field
+ 
+ The number is rounded to PARM_FLOAT_DECIMALS decimal digits and is written in
+ the form 0000000.000, left-filled with zeroes.
+ 
+ \param buffer The destination buffer, at least PARM_FLOAT_LEN characters long
+ \param value The value to convert
+ \return false if the number is not finite or does not fit in the field width
+ */
+bool CommandProcessor::encodeFloat(char* buffer, float value) {
+	//! Integer part width, including the sign if negative
+	int intWidth = PARM_FLOAT_LEN - PARM_FLOAT_DECIMALS - 1;
+	unsigned long scale = 1;
+	unsigned long intPart;
+	unsigned long decPart;
+	double absValue = value < 0 ? -(double)value : (double)value;
+
+	for(int j = 0; j < PARM_FLOAT_DECIMALS; j++)
+		scale *= 10;
+
+	// Reject NaN and the infinities, then the values out of range
+	if(value != value)
+		return false;
+	if(absValue >= 4294967295.0)
+		return false;
+
+	// Split the rounded value in the integer and decimal parts
+	intPart = (unsigned long)absValue;
+	decPart = (unsigned long)((absValue - intPart) * scale + 0.5);
+	if(decPart >= scale) {
+		intPart++;
+		decPart -= scale;
+	} // Rounding carry
+
+	if(value < 0) {
+		buffer[0] = '-';
+		if(!encodeDigits(buffer + 1, intPart, intWidth - 1))
+			return false;
+	} // Negative number
+	else {
+		if(!encodeDigits(buffer, intPart, intWidth))
+			return false;
+	} // Positive number
+	buffer[intWidth] = '.';
+
+	return encodeDigits(buffer + intWidth + 1, decPart, PARM_FLOAT_DECIMALS);
+}
+
+/**
+ \brief Encode a boolean in a PARM_BOOL_LEN field as 0 or 1
+ */
+bool CommandProcessor::encodeBool(char* buffer, bool value) {
+	return encodeField(buffer, value ? 1 : 0, PARM_BOOL_LEN);
+}
+
+/**
+ \brief Decode a fixed width integer field
+ 
+ \param buffer The field characters
+ \param width The field width in characters
+ \param value The decoded value
+ \return false if the field contains non-numeric characters
+ */
+bool CommandProcessor::decodeField(const char* buffer, int width, long& value) {
+	long result = 0;
+	bool isNegative = false;
+	int j = 0;
+
+	if(width <= 0)
+		return false;
+
+	if(buffer[0] == '-') {
+		isNegative = true;
+		j++;
+	} // Negative number
+
+	if(j == width)
+		return false;
+
+	for(; j < width; j++) {
+		if( (buffer[j] < '0') || (buffer[j] > '9') )
+			return false;
+		result = result * 10 + (buffer[j] - '0');
+	}
+
+	value = isNegative ? -result : result;
+	return true;
+}
+
+/**
+ \brief Decode a PARM_INTEGER_LEN field
+ */
+bool CommandProcessor::decodeInteger(const char* buffer, int& value) {
+	long result;
+
+	if(!decodeField(buffer, PARM_INTEGER_LEN, result))
+		return false;
+
+	value = (int)result;
+	return true;
+}
+
+/**
+ \brief Decode a PARM_LONGINT_LEN field
+ */
+bool CommandProcessor::decodeLong(const char* buffer, long& value) {
+	return decodeField(buffer, PARM_LONGINT_LEN, value);
+}
+
+/**
+ \brief Decode a PARM_FLOAT_LEN field in the form 0000000.000
+ 
+ \param buffer The field characters
+ \param value The decoded value
+ \return false if the field is malformed
+ */
+bool CommandProcessor::decodeFloat(const char* buffer, float& value) {
+	int intWidth = PARM_FLOAT_LEN - PARM_FLOAT_DECIMALS - 1;
+	long intPart;
+	long decPart;
+	float scale = 1;
+
+	if(buffer[intWidth] != '.')
+		return false;
+	if(!decodeField(buffer, intWidth, intPart))
+		return false;
+	if( (buffer[intWidth + 1] == '-') ||
+			!decodeField(buffer + intWidth + 1, PARM_FLOAT_DECIMALS, decPart) )
+		return false;
+
+	for(int j = 0; j < PARM_FLOAT_DECIMALS; j++)
+		scale *= 10;
+
+	// The sign of the integer part applies to the decimals too (also for -0)
+	if(buffer[0] == '-')
+		value = (float)intPart - (float)decPart / scale;
+	else
+		value = (float)intPart + (float)decPart / scale;
+
+	return true;
+}
+
+/**
+ \brief Decode a PARM_BOOL_LEN field
+ 
+ \return false if the field is not 0 or 1
+ */
+bool CommandProcessor::decodeBool(const char* buffer, bool& value) {
+	long result;
+
+	if(!decodeField(buffer, PARM_BOOL_LEN, result) || (result > 1))
+		return false;
+
+	value = result == 1;
+	return true;
+}
+
+/**
+ \brief Decode the result code of a board response
+ 
+ The result code is the last field of the response, after the last
+ RESPONSE_SEPARATOR, e.g. ":L:0".
+ 
+ \param message The response string
+ \param result The decoded result code, e.g. COMMAND_OK
+ \return false if the response does not end with a result code
+ */
+bool CommandProcessor::decodeResult(const char* message, int& result) {
+	const char* field = strrchr(message, RESPONSE_SEPARATOR[0]);
+	long value;
+
+	if(field == NULL)
+		return false;
+	field++;
+
+	if(!decodeField(field, strlen(field), value))
+		return false;
+
+	result = (int)value;
+	return true;
+}
+
+/**
+ \brief Write the digits of an unsigned number, left-filled with zeroes
+ 
+ \param buffer The destination buffer
+ \param value The number to convert
+ \param width The number of digits to write
+ \return false if the number has more digits than the width
+ */
+bool CommandProcessor::encodeDigits(char* buffer, unsigned long value, int width) {
+	if(width <= 0)
+		return false;
+
+	for(int j = width - 1; j >= 0; j--) {
+		buffer[j] = '0' + (value % 10);
+		value /= 10;
+	}
+
+	return value == 0;
+}
@@ -5,9 +5,8 @@
 
 #include "LCDTemplatesMaster.h"
 #include "CommandParameters.h"
-#include <iomanip>
-#include <locale>
-#include <sstream>
+#include "LinkProtocol.h"
+#include "DisplayMirror.h"
 #include <string.h>
 
 #ifndef COMMANDPROCESSOR_H
@@ -17,14 +16,73 @@ class CommandProcessor: public LCDTemplatesMaster {
 public:
 	CommandProcessor();
 	virtual ~CommandProcessor();
-	char* buildCommandDisplayTemplate(int templateID);
+	const commandFrame& buildCommandDisplayTemplate(int templateID);
+	bool updateDisplay(int templateID, int fieldID, const char* val);
+	const commandFrame& buildFieldUpdate(int fieldID);
+	const commandFrame& buildLinkModeCommand(bool enable);
+	const commandFrame& buildEnableCommand(char probe, bool enable);
+	void invalidateMirror();
+	void commitMirror(int sequence);
+	int getActiveTemplate();
+	int getRequestedTemplate();
+	const commandFrame& stampSequence(const commandFrame& command, int sequence);
+	const commandFrame& buildParameterCommand(int parameterID);
+	void setBinaryMode(bool enable);
+	bool isBinaryMode();
+
+	static bool encodeField(char* buffer, long value, int width);
+	static bool encodeInteger(char* buffer, int value);
+	static bool encodeLong(char* buffer, long value);
+	static bool encodeFloat(char* buffer, float value);
+	static bool encodeBool(char* buffer, bool value);
+	static bool decodeField(const char* buffer, int width, long& value);
+	static bool decodeInteger(const char* buffer, int& value);
+	static bool decodeLong(const char* buffer, long& value);
+	static bool decodeFloat(const char* buffer, float& value);
+	static bool decodeBool(const char* buffer, bool& value);
+	static bool decodeResult(const char* message, int& result);
 private:
 	LCDTemplatesMaster mTemplates;
-	
-	std::string intToString(int i);
-	std::string intToString(int i, int l);
-	int stringToInt(std::string &s);
 
+	//! The serialized template commands, built once and updated only
+	//! when a field content changes
+	commandFrame templateFrames[MAX_TEMPLATES];
+	//! The template commands to build again before they are sent, as a field
+	//! content has changed
+	bool isFrameStale[MAX_TEMPLATES];
+	//! The current content of every template field
+	char templateValues[MAX_TEMPLATES][MAX_FIELDS][CMD_MSGLEN + 1];
+	//! The number of fields of every template
+	int templateNumFields[MAX_TEMPLATES];
+	//! The template commands encoded with the binary protocol
+	commandFrame binaryFrames[MAX_TEMPLATES];
+	//! Frame returned for the invalid template IDs
+	commandFrame emptyFrame;
+	//! The display state set on the board by the acknowledged commands
+	DisplayMirror mirror;
+	//! The last template requested with buildCommandDisplayTemplate() or
+	//! MIRROR_UNKNOWN
+	int requestedTemplate;
+	//! The last field update command
+	commandFrame fieldFrame;
+	//! The last probe enable command
+	commandFrame enableFrame;
+	//! The link mode request command
+	commandFrame linkModeFrame;
+	//! The last command tagged with the sequence ID
+	commandFrame sequenceFrame;
+	//! The last parameter value command
+	commandFrame parameterFrame;
+	//! When true the binary frames are returned instead of the ASCII commands
+	bool binaryMode;
+	
+	void buildTemplateFrame(int templateID);
+	void buildBinaryFrame(int templateID);
+	void buildFieldFrame(int templateID, int fieldID);
+	void decodeChange(const commandFrame& command, mirrorChange& change);
+	void decodeBinaryChange(LinkFrame& frame, mirrorChange& change);
+	static int decodeString(const commandFrame& command, int position, char* value);
+	static bool encodeDigits(char* buffer, unsigned long value, int width);
 };
 
 #endif	/* COMMANDPROCESSOR_H */
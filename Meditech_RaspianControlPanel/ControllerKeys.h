@@ -16,6 +16,11 @@
  
  */
 
+#include <stdint.h>
+#include "CommandParameters.h"
+#include "SerialReceiver.h"
+#include "AudioCodec.h"
+
 #ifndef CONTROLLERKEYS_H
 #define	CONTROLLERKEYS_H
 
@@ -80,11 +85,31 @@
 void parseIR(int);
 void initFlags(void);
 void setPowerOffStatus(int);
+void selectProbe(int);
 void manageSerial(void);
-void ttsStrings(void);
+void queueCommand(const commandFrame&);
+void fillWindow(void);
+void readSerial(void);
+void dispatchFrame(const receivedFrame&);
+void responseReceived(int, const char*);
+void masterRequest(int);
+int ttsStrings(void);
+void audioBench(void);
+void benchClip(const char*, const audioClip&);
 int spawn (char*, char**);
 void playRemoteMessage(int);
-void remoteMount_Umount(bool);
+void irEvent(int, uint32_t, void*);
+void serialEvent(int, uint32_t, void*);
+void timerEvent(int, uint32_t, void*);
+void displayEvent(int, uint32_t, void*);
+void updateClock(void);
+void childEvent(int, uint32_t, void*);
+void scheduleAudioRestart(void);
+void audioRestartEvent(int, uint32_t, void*);
+void restartAudioWorker(void);
+void audioEvent(int, uint32_t, void*);
+void completeStartupStep(int, bool);
+void startupReady(void);
 
 #endif	/* CONTROLLERKEYS_H */
 
@@ -0,0 +1,207 @@
+/**
+ \file DisplayMirror.cpp
+ \brief DisplayMirror class keeps the copy of the control panel board display state.
+ */
+
+#include "DisplayMirror.h"
+#include <string.h>
+
+/**
+ \brief Constructor method. The board state is unknown
+ */
+DisplayMirror::DisplayMirror() {
+	invalidate();
+	for(int j = 0; j < MAX_SEQUENCE; j++)
+		pending[j].type = CMD_NULLCHAR;
+}
+
+/**
+ \brief Destructor method
+ */
+DisplayMirror::~DisplayMirror() {
+}
+
+/**
+ \brief Forget the board state
+
+ Used when the board may have lost its state, so the next commands are sent
+ even if they seem to repeat the previous ones.
+ */
+void DisplayMirror::invalidate() {
+	activeTemplate = MIRROR_UNKNOWN;
+	numFields = 0;
+	probeBits = 0;
+	knownProbes = 0;
+}
+
+/**
+ \brief Return the template shown by the board or MIRROR_UNKNOWN
+ */
+int DisplayMirror::getTemplate() {
+	return activeTemplate;
+}
+
+/**
+ \brief Check if the board already shows a template with the specified fields
+
+ \param templateID The template ID
+ \param values The field strings
+ \param fieldCount The number of fields
+ \return true if the template command would not change the display
+ */
+bool DisplayMirror::isTemplateShown(int templateID, const char values[][CMD_MSGLEN + 1],
+		int fieldCount) {
+	if( (templateID != activeTemplate) || (fieldCount != numFields) )
+		return false;
+
+	for(int j = 0; j < numFields; j++) {
+		if(strcmp(fields[j], values[j]) != 0)
+			return false;
+	} // Compare the fields
+
+	return true;
+}
+
+/**
+ \brief Record a template command executed by the board
+
+ \param templateID The template ID
+ \param values The field strings
+ \param fieldCount The number of fields, up to MAX_FIELDS
+ */
+void DisplayMirror::showTemplate(int templateID, const char values[][CMD_MSGLEN + 1],
+		int fieldCount) {
+	if( (fieldCount < 0) || (fieldCount > MAX_FIELDS) ) {
+		activeTemplate = MIRROR_UNKNOWN;
+		return;
+	} // Not a template
+
+	activeTemplate = templateID;
+	numFields = fieldCount;
+	for(int j = 0; j < numFields; j++) {
+		strncpy(fields[j], values[j], CMD_MSGLEN);
+		fields[j][CMD_MSGLEN] = CMD_NULLCHAR;
+	} // Copy the fields
+}
+
+/**
+ \brief Check if a field of the active template already shows a string
+
+ \param fieldID The field ID
+ \param val The field string
+ \return true if the field update command would not change the display
+ */
+bool DisplayMirror::isFieldShown(int fieldID, const char* val) {
+	if( (activeTemplate == MIRROR_UNKNOWN) || (fieldID < 0) || (fieldID >= numFields) )
+		return false;
+
+	return strncmp(fields[fieldID], val, CMD_MSGLEN) == 0;
+}
+
+/**
+ \brief Record a field update command executed by the board
+
+ \param fieldID The field of the active template
+ \param val The field string
+ */
+void DisplayMirror::showField(int fieldID, const char* val) {
+	if( (activeTemplate == MIRROR_UNKNOWN) || (fieldID < 0) || (fieldID >= numFields) )
+		return;
+
+	strncpy(fields[fieldID], val, CMD_MSGLEN);
+	fields[fieldID][CMD_MSGLEN] = CMD_NULLCHAR;
+}
+
+/**
+ \brief Check if the status of a probe is already set on the board
+
+ \param probe The probe subcommand (see MIRROR_PROBES)
+ \param enable The probe status
+ \return true if the enable command would not change the board status
+ */
+bool DisplayMirror::isProbeSet(char probe, bool enable) {
+	unsigned int bit = getProbeBit(probe);
+
+	if( (knownProbes & bit) == 0)
+		return false;
+
+	return ((probeBits & bit) != 0) == enable;
+}
+
+/**
+ \brief Record a probe enable command executed by the board
+
+ \param probe The probe subcommand (see MIRROR_PROBES)
+ \param enable The probe status
+ */
+void DisplayMirror::setProbe(char probe, bool enable) {
+	unsigned int bit = getProbeBit(probe);
+
+	knownProbes |= bit;
+	if(enable)
+		probeBits |= bit;
+	else
+		probeBits &= ~bit;
+}
+
+/**
+ \brief Record the display change of a command sent with a sequence ID
+
+ The change is applied by commit() when the board acknowledges the command.
+ The change recorded for a previous use of the sequence ID is replaced.
+
+ \param sequence The sequence ID sent with the command
+ \param change The display change, type CMD_NULLCHAR if none
+ */
+void DisplayMirror::expect(int sequence, const mirrorChange& change) {
+	if( (sequence < 0) || (sequence >= MAX_SEQUENCE) )
+		return;
+
+	pending[sequence] = change;
+}
+
+/**
+ \brief Apply the display change of a command executed by the board
+
+ Should be called only for the COMMAND_OK responses matching a command still
+ waiting for the response. The change is applied once.
+
+ \param sequence The sequence ID of the response
+ */
+void DisplayMirror::commit(int sequence) {
+	if( (sequence < 0) || (sequence >= MAX_SEQUENCE) )
+		return;
+
+	mirrorChange& change = pending[sequence];
+	switch(change.type) {
+		case CMD_LCDTEMPLATE:
+			showTemplate(change.id, change.values, change.fieldCount);
+			break;
+		case CMD_FIELD:
+			showField(change.id, change.values[0]);
+			break;
+		case CMD_ENABLE:
+			setProbe((char)change.id, change.enable);
+			break;
+		default:
+			break;
+	} // Display change types
+
+	change.type = CMD_NULLCHAR;
+}
+
+/**
+ \brief Return the bit of a probe subcommand or 0 if it is not a probe
+ */
+unsigned int DisplayMirror::getProbeBit(char probe) {
+	const char* position;
+
+	if(probe == CMD_NULLCHAR)
+		return 0;
+
+	position = strchr(MIRROR_PROBES, probe);
+	if(position == NULL)
+		return 0;
+
+	return 1u << (position - MIRROR_PROBES);
+}
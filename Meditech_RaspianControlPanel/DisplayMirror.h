@@ -0,0 +1,79 @@
+/**
+\file DisplayMirror.h
+\brief Master side copy of the control panel board display state.
+
+ The master keeps the state it has set on the board: the template shown on the
+ LCD with the content of its fields and the enabled probes. Every command is
+ compared with the mirror before it is sent, so a command that would not
+ change the board (e.g. a template requested again by a remote key repeat) is
+ not sent at all. The display change of every command sent is recorded with its
+ sequence ID and applied to the mirror only when the board acknowledges the
+ command with COMMAND_OK, so the mirror holds only the state the board has
+ really set.
+
+ When the board state is not known (at startup or when the board does not
+ respond and may have been reset) the mirror is invalidated, so the next
+ commands are sent in full and the mirror is built again.
+ */
+
+#include "CommandParameters.h"
+#include "LCDTemplatesMaster.h"
+
+#ifndef DISPLAYMIRROR_H
+#define	DISPLAYMIRROR_H
+
+//! The probe subcommands, in the order of the probe bits
+#define MIRROR_PROBES "SGPTH"
+
+//! The template ID when the template shown by the board is unknown
+#define MIRROR_UNKNOWN -1
+
+/**
+ \brief The display change of a command waiting for the board ack
+ */
+typedef struct MirrorChange {
+	//! The command: CMD_LCDTEMPLATE, CMD_FIELD, CMD_ENABLE or CMD_NULLCHAR
+	//! for the commands that do not change the display
+	char type;
+	//! The template ID, the field ID or the probe subcommand
+	int id;
+	//! The requested probe status
+	bool enable;
+	//! The number of strings in values
+	int fieldCount;
+	//! The template field strings or the field string
+	char values[MAX_FIELDS][CMD_MSGLEN + 1];
+} mirrorChange;
+
+class DisplayMirror {
+public:
+	DisplayMirror();
+	virtual ~DisplayMirror();
+	void invalidate();
+	int getTemplate();
+	bool isTemplateShown(int templateID, const char values[][CMD_MSGLEN + 1], int fieldCount);
+	void showTemplate(int templateID, const char values[][CMD_MSGLEN + 1], int fieldCount);
+	bool isFieldShown(int fieldID, const char* val);
+	void showField(int fieldID, const char* val);
+	bool isProbeSet(char probe, bool enable);
+	void setProbe(char probe, bool enable);
+	void expect(int sequence, const mirrorChange& change);
+	void commit(int sequence);
+private:
+	//! The template shown by the board or MIRROR_UNKNOWN
+	int activeTemplate;
+	//! The number of fields of the active template
+	int numFields;
+	//! The field strings shown by the board
+	char fields[MAX_FIELDS][CMD_MSGLEN + 1];
+	//! The enabled probes, a bit for every MIRROR_PROBES subcommand
+	unsigned int probeBits;
+	//! The probes whose status is known, a bit for every MIRROR_PROBES subcommand
+	unsigned int knownProbes;
+	//! The display changes of the commands sent, by sequence ID
+	mirrorChange pending[MAX_SEQUENCE];
+
+	static unsigned int getProbeBit(char probe);
+};
+
+#endif	/* DISPLAYMIRROR_H */
@@ -0,0 +1,103 @@
+/**
+ \file DisplayScheduler.cpp
+ \brief DisplayScheduler class limits the rate of the field updates sent to the board.
+ */
+
+#include "DisplayScheduler.h"
+
+/**
+ \brief Constructor method
+
+ \param processor The CommandProcessor building the board commands
+ */
+DisplayScheduler::DisplayScheduler(CommandProcessor& processor) : cProc(processor) {
+	hasChanges = false;
+	backoff = 1;
+	skipped = 0;
+}
+
+/**
+ \brief Destructor method
+ */
+DisplayScheduler::~DisplayScheduler() {
+}
+
+/**
+ \brief Store the new content of a template field
+
+ The field is sent by the next flush if its template is shown by the board.
+
+ \param templateID The id of the template
+ \param fieldID The field to update
+ \param val The new field string
+ \return true if the field has been changed, else false
+ */
+bool DisplayScheduler::update(int templateID, int fieldID, const char* val) {
+	if(!cProc.updateDisplay(templateID, fieldID, val))
+		return false;
+
+	hasChanges = true;
+	return true;
+}
+
+/**
+ \brief Send the fields of the active template changed since the last flush
+
+ Should be called by the display timer, every DISPLAY_FLUSH_PERIOD. If the
+ template shown by the board is not known the last requested template is sent
+ again, with the latest content of all its fields, after an increasing number
+ of flushes while it is not acknowledged. The changes are kept until the
+ template is known, so no field update is lost.
+
+ \param send The function queuing the commands
+ \return The number of commands sent
+ */
+int DisplayScheduler::flush(DisplaySender send) {
+	int templateID = cProc.getActiveTemplate();
+	int count = 0;
+
+	if(templateID == MIRROR_UNKNOWN) {
+		templateID = cProc.getRequestedTemplate();
+		if(templateID == MIRROR_UNKNOWN)
+			return 0;
+		if(skipped > 0) {
+			skipped--;
+			return 0;
+		} // Wait before the next resend
+		const commandFrame& command = cProc.buildCommandDisplayTemplate(templateID);
+		if(command.length == 0)
+			return 0;
+		send(command);
+		skipped = backoff;
+		backoff *= 2;
+		if(backoff > DISPLAY_MAX_BACKOFF)
+			backoff = DISPLAY_MAX_BACKOFF;
+		return 1;
+	} // Board display not known
+
+	// The board shows a template: the next resend is immediate
+	backoff = 1;
+	skipped = 0;
+
+	if(!hasChanges)
+		return 0;
+
+	for(int j = 0; j < MAX_FIELDS; j++) {
+		const commandFrame& command = cProc.buildFieldUpdate(j);
+		if(command.length == 0)
+			continue;
+		send(command);
+		count++;
+	} // Send the changed fields
+
+	hasChanges = false;
+
+	return count;
+}
+
+/**
+ \brief Check if some fields have changed since the last flush
+ */
+bool DisplayScheduler::isPending() {
+	return hasChanges;
+}
@@ -0,0 +1,58 @@
+/**
+\file DisplayScheduler.h
+\brief Rate limiter of the template field updates sent to the control panel board.
+
+ The probe values can change much faster than the serial link and the LCD can
+ show them. The field updates are not sent when they arrive: the new contents
+ are stored in the CommandProcessor templates and the scheduler sends the
+ changed fields of the active template when the display timer expires, every
+ DISPLAY_FLUSH_PERIOD. A field changed many times between two flushes is sent
+ once with its latest value and the fields of the other templates are sent only
+ with their next template command, so the link use is bounded whatever the
+ update rate.
+
+ The template changes requested with the IR controller are not scheduled: the
+ template command is queued immediately and includes the latest field values.
+ When the board display state is not known (e.g. after a timeout or an error
+ response) the flush sends again the last requested template. A board that
+ does not accept the template (or is not connected) would receive it at every
+ flush, so the resends are spaced out, doubling the number of skipped flushes
+ up to DISPLAY_MAX_BACKOFF until the template is acknowledged.
+ */
+
+#include "CommandProcessor.h"
+
+#ifndef DISPLAYSCHEDULER_H
+#define	DISPLAYSCHEDULER_H
+
+//! Max number of field update flushes per second
+#define DISPLAY_MAX_RATE 4
+
+//! Period of the field update flushes (ms)
+#define DISPLAY_FLUSH_PERIOD (1000 / DISPLAY_MAX_RATE)
+
+//! Max number of flushes skipped between two resends of the template
+#define DISPLAY_MAX_BACKOFF 64
+
+//! The function queuing a command for the board
+typedef void (*DisplaySender)(const commandFrame& command);
+
+class DisplayScheduler {
+public:
+	DisplayScheduler(CommandProcessor& processor);
+	virtual ~DisplayScheduler();
+	bool update(int templateID, int fieldID, const char* val);
+	int flush(DisplaySender send);
+	bool isPending();
+private:
+	//! The templates holding the field contents
+	CommandProcessor& cProc;
+	//! Some fields have changed since the last flush
+	bool hasChanges;
+	//! Number of flushes to skip after the next template resend
+	int backoff;
+	//! Number of flushes still to skip before the template is sent again
+	int skipped;
+};
+
+#endif	/* DISPLAYSCHEDULER_H */
@@ -0,0 +1,267 @@
+/**
+ \file EventLoop.cpp
+ \brief EventLoop class manages the single epoll instance of the controller and
+ dispatches the ready file descriptors to the registered callbacks.
+
+ Timers are created as timerfd descriptors so they are dispatched exactly as the
+ other sources; the timer expirations counter is read by the loop before calling
+ the timer callback.
+ */
+
+#include "EventLoop.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+
+/**
+ \brief Constructor method
+ */
+EventLoop::EventLoop() {
+	epollFd = -1;
+	isRunning = false;
+
+	for(int j = 0; j < MAX_EVENT_WATCHES; j++) {
+		watches[j].fd = -1;
+		watches[j].isTimer = false;
+		watches[j].callback = NULL;
+		watches[j].context = NULL;
+	}
+}
+
+/**
+ \brief Destructor method
+
+ Closes the timers owned by the loop and the epoll instance. The other watched
+ descriptors are owned by the caller and are not closed.
+ */
+EventLoop::~EventLoop() {
+	for(int j = 0; j < MAX_EVENT_WATCHES; j++) {
+		if( (watches[j].fd != -1) && watches[j].isTimer)
+			close(watches[j].fd);
+	}
+
+	if(epollFd != -1)
+		close(epollFd);
+}
+
+/**
+ \brief Create the epoll instance
+
+ \return true if the epoll instance has been created
+ */
+bool EventLoop::open() {
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+	return epollFd != -1;
+}
+
+/**
+ \brief Add a file descriptor to the watched sources
+
+ \param fd The file descriptor to watch. It should be already set in non-blocking mode
+ \param events The epoll events mask (usually EPOLLIN)
+ \param callback The function called when the descriptor is ready
+ \param context The user pointer passed to the callback
+ \return true if the descriptor has been registered
+ */
+bool EventLoop::addWatch(int fd, uint32_t events, EventCallback callback, void* context) {
+	return registerWatch(fd, events, callback, context) != NULL;
+}
+
+/**
+ \brief Change the events mask of an already watched file descriptor
+
+ \param fd The watched file descriptor
+ \param events The new epoll events mask
+ \return true if the mask has been changed
+ */
+bool EventLoop::modifyWatch(int fd, uint32_t events) {
+	struct epoll_event ev;
+
+	if(findWatch(fd) == NULL)
+		return false;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.fd = fd;
+
+	return epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+/**
+ \brief Remove a file descriptor from the watched sources
+
+ \param fd The watched file descriptor
+ */
+void EventLoop::removeWatch(int fd) {
+	EventWatch* w = findWatch(fd);
+
+	if(w == NULL)
+		return;
+
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+	w->fd = -1;
+	w->isTimer = false;
+	w->callback = NULL;
+	w->context = NULL;
+}
+
+/**
+ \brief Create a periodic timer dispatched by the loop
+
+ \param periodMs The timer period in milliseconds
+ \param callback The function called every time the timer expires
+ \param context The user pointer passed to the callback
+ \return The timer file descriptor or -1 if the timer can't be created
+ */
+int EventLoop::addTimer(int periodMs, EventCallback callback, void* context) {
+	struct itimerspec period;
+	int timerFd;
+	EventWatch* w;
+
+	timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if(timerFd == -1)
+		return -1;
+
+	period.it_interval.tv_sec = periodMs / 1000;
+	period.it_interval.tv_nsec = (periodMs % 1000) * 1000000L;
+	period.it_value = period.it_interval;
+
+	if(timerfd_settime(timerFd, 0, &period, NULL) == -1) {
+		close(timerFd);
+		return -1;
+	} // Timer can't be armed
+
+	w = registerWatch(timerFd, EPOLLIN, callback, context);
+	if(w == NULL) {
+		close(timerFd);
+		return -1;
+	} // No more room for watches
+
+	w->isTimer = true;
+	return timerFd;
+}
+
+/**
+ \brief Stop and remove a timer created by addTimer()
+
+ \param timerFd The timer file descriptor returned by addTimer()
+ */
+void EventLoop::removeTimer(int timerFd) {
+	EventWatch* w = findWatch(timerFd);
+
+	if( (w == NULL) || !w->isTimer)
+		return;
+
+	removeWatch(timerFd);
+	close(timerFd);
+}
+
+/**
+ \brief Run the loop dispatching the ready events until stop() is called
+
+ \return 0 when the loop has been stopped or -1 on epoll errors
+ */
+int EventLoop::run() {
+	struct epoll_event ready[MAX_READY_EVENTS];
+	uint64_t expirations;
+	int nReady;
+
+	isRunning = true;
+
+	while(isRunning) {
+		nReady = epoll_wait(epollFd, ready, MAX_READY_EVENTS, -1);
+
+		if(nReady == -1) {
+			if(errno == EINTR)
+				continue;
+			isRunning = false;
+			return -1;
+		} // Wait error
+
+		for(int j = 0; (j < nReady) && isRunning; j++) {
+			// The watch is searched again as a previous callback in the same
+			// cycle may have removed it.
+			EventWatch* w = findWatch(ready[j].data.fd);
+			if(w == NULL)
+				continue;
+
+			// Timers should be read to clear the expirations counter
+			if(w->isTimer) {
+				if(read(w->fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+					continue;
+			}
+
+			w->callback(w->fd, ready[j].events, w->context);
+		} // Dispatch the ready events
+	} // Main loop
+
+	return 0;
+}
+
+/**
+ \brief Stop the loop. The run() method returns after the current dispatch cycle.
+ */
+void EventLoop::stop() {
+	isRunning = false;
+}
+
+/**
+ \brief Return the monotonic clock time in milliseconds
+ */
+long EventLoop::currentTime() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ \brief Search the watch registered with a file descriptor
+
+ \param fd The watched file descriptor
+ \return The watch entry or NULL if the descriptor is not watched
+ */
+EventWatch* EventLoop::findWatch(int fd) {
+	for(int j = 0; j < MAX_EVENT_WATCHES; j++) {
+		if(watches[j].fd == fd)
+			return &watches[j];
+	}
+
+	return NULL;
+}
+
+/**
+ \brief Store a new watch in a free entry and add the descriptor to epoll
+
+ \return The registered watch or NULL if the descriptor can't be watched
+ */
+EventWatch* EventLoop::registerWatch(int fd, uint32_t events, EventCallback callback, void* context) {
+	struct epoll_event ev;
+	EventWatch* w;
+
+	if( (epollFd == -1) || (fd < 0) || (callback == NULL) || (findWatch(fd) != NULL) )
+		return NULL;
+
+	// Search a free entry
+	w = findWatch(-1);
+	if(w == NULL)
+		return NULL;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.fd = fd;
+
+	if(epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) == -1)
+		return NULL;
+
+	w->fd = fd;
+	w->isTimer = false;
+	w->callback = callback;
+	w->context = context;
+
+	return w;
+}
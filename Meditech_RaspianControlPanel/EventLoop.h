@@ -0,0 +1,74 @@
+/**
+\file EventLoop.h
+\brief Single-thread epoll reactor dispatching the controller events.
+
+ The controller must react to the IR remote, to the serial link with the control
+ panel board and to periodic timed actions. All these sources are file descriptors
+ (the lirc socket, the UART device and the timerfd timers) so they are watched by
+ a single epoll instance and every ready descriptor is dispatched to the callback
+ registered with it. No source can delay the others as no call is blocking.
+ */
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#ifndef EVENTLOOP_H
+#define	EVENTLOOP_H
+
+//! Max number of file descriptors watched at the same time by the loop
+#define MAX_EVENT_WATCHES 16
+
+//! Max number of ready events processed for every epoll_wait() call
+#define MAX_READY_EVENTS 8
+
+/**
+ \brief Event callback function type
+
+ \param fd The file descriptor that is ready
+ \param events The epoll ready events mask (EPOLLIN, EPOLLOUT etc.)
+ \param context The user pointer passed registering the watch
+ */
+typedef void (*EventCallback)(int fd, uint32_t events, void* context);
+
+/**
+ \brief Watched file descriptor registration data
+ */
+typedef struct EventWatchEntry {
+	//! The watched file descriptor or -1 if the entry is free
+	int fd;
+	//! True if the descriptor is a timerfd owned by the loop
+	bool isTimer;
+	//! Function called when the descriptor is ready
+	EventCallback callback;
+	//! User pointer passed to the callback
+	void* context;
+} EventWatch;
+
+class EventLoop {
+public:
+	EventLoop();
+	virtual ~EventLoop();
+	bool open();
+	bool addWatch(int fd, uint32_t events, EventCallback callback, void* context);
+	bool modifyWatch(int fd, uint32_t events);
+	void removeWatch(int fd);
+	int addTimer(int periodMs, EventCallback callback, void* context);
+	void removeTimer(int timerFd);
+	int run();
+	void stop();
+
+	static long currentTime();
+private:
+	//! The epoll instance descriptor
+	int epollFd;
+	//! Loop running flag. When false run() returns to the caller
+	bool isRunning;
+	//! The registered watches
+	EventWatch watches[MAX_EVENT_WATCHES];
+
+	EventWatch* findWatch(int fd);
+	EventWatch* registerWatch(int fd, uint32_t events, EventCallback callback, void* context);
+};
+
+#endif	/* EVENTLOOP_H */
+
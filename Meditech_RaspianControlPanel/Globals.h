@@ -24,6 +24,20 @@
 //! To-send status: response received from remote. Start parsing
 #define SERIAL_RESPONSE_RECEIVED	4
 
+//! Link mode: the commands are sent as ASCII strings
+#define LINK_MODE_ASCII			0
+//! Link mode: the binary protocol has been requested, waiting for the board ack
+#define LINK_MODE_NEGOTIATING	1
+//! Link mode: the commands are sent as binary frames (see LinkProtocol.h)
+#define LINK_MODE_BINARY		2
+
+//! When true the master asks the board to use the binary protocol at startup.
+//! If the board does not acknowledge the request the ASCII commands are used.
+#define LINK_USE_BINARY true
+
+//! Period of the controller timer running the periodic work (ms)
+#define CONTROLLER_TIMER_PERIOD 100
+
 //! Active probe code: no probes acitve
 #define PROBE_ACTIVE_NONE			0
 //! Active probe code: last request sent to stethoscope
@@ -48,6 +62,10 @@
 //! strings instead the normal execution.
 #define VOICE_STRINGS "-v"
 
+//! Command code to measure the size and the time of the voice messages
+//! IMA-ADPCM encoding.
+#define BENCH_AUDIO "-b"
+
 /**
  \brief Boolean states and flags to take track of the application status.
  Note that some of these status parameters are updated on the database for
@@ -63,8 +81,8 @@ typedef struct ControllerStatusFlags {
 	int serialState;
 	
 	/**
-	 Active probe is the last probe request sent to the control panel that returned 
-	 a confirmation answer. This status variable can assume the following values: 
+	 Active probe is the last probe enabled on the control panel by selectProbe().
+	 This status variable can assume the following values: 
 	 */
 	int activeProbe;
 	
@@ -97,6 +115,12 @@ typedef struct ControllerStatusFlags {
 	//! Voice messages status
 	bool isMuted;
 	
+	/**
+	 Protocol used to send the commands to the control panel board. It can assume
+	 the following values: LINK_MODE_ASCII, LINK_MODE_NEGOTIATING, LINK_MODE_BINARY
+	 */
+	int linkMode;
+	
 } states;
 
 #endif	/* GLOBALS_H */
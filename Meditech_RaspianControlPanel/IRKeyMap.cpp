@@ -0,0 +1,106 @@
+/**
+ \file IRKeyMap.cpp
+ \brief IRKeyMap class identifies the IR controller key of a lirc code.
+ */
+
+#include "IRKeyMap.h"
+#include <string.h>
+
+/**
+ \brief Constructor method
+
+ Builds the hash table of the key names. The key ID is the position of the
+ key name in the array.
+
+ \param keys The key names array. The array should remain valid for the class
+ instance life
+ \param numKeys The number of key names, lower than IR_HASH_SIZE. At least
+ one slot remains empty so the search always ends
+ */
+IRKeyMap::IRKeyMap(const char* const* keys, int numKeys) {
+	int slot;
+
+	keyNames = keys;
+	for(int j = 0; j < IR_HASH_SIZE; j++)
+		slots[j] = IR_KEY_NONE;
+
+	for(int k = 0; (k < numKeys) && (k < IR_HASH_SIZE - 1); k++) {
+		slot = hash(keys[k], strlen(keys[k])) % IR_HASH_SIZE;
+		while(slots[slot] != IR_KEY_NONE)
+			slot = (slot + 1) % IR_HASH_SIZE;
+		slots[slot] = k;
+	} // Load the keys
+}
+
+/**
+ \brief Destructor method
+ */
+IRKeyMap::~IRKeyMap() {
+}
+
+/**
+ \brief Identify the key of a lirc code line
+
+ \param code The lirc code line, in the format <code> <repeat> <key name> <remote name>
+ \return The key ID or IR_KEY_NONE if the key name is unknown
+ */
+int IRKeyMap::find(const char* code) {
+	const char* name = code;
+	int length;
+
+	// Skip the code and the repeat counter tokens
+	for(int t = 0; t < 2; t++) {
+		while( (*name != '\0') && (*name != ' ') )
+			name++;
+		while(*name == ' ')
+			name++;
+	} // Skip the tokens
+
+	for(length = 0; (name[length] != '\0') && (name[length] != ' ') &&
+			(name[length] != '\n'); length++)
+		;
+
+	return findKey(name, length);
+}
+
+/**
+ \brief Search a key name in the hash table
+
+ \param name The key name, not necessarily null terminated
+ \param length The key name length
+ \return The key ID or IR_KEY_NONE if the key name is unknown
+ */
+int IRKeyMap::findKey(const char* name, int length) {
+	int slot;
+
+	if(length <= 0)
+		return IR_KEY_NONE;
+
+	slot = hash(name, length) % IR_HASH_SIZE;
+	while(slots[slot] != IR_KEY_NONE) {
+		const char* key = keyNames[slots[slot]];
+		if( (strncmp(key, name, length) == 0) && (key[length] == '\0') )
+			return slots[slot];
+		slot = (slot + 1) % IR_HASH_SIZE;
+	} // Search the slots with the same hash
+
+	return IR_KEY_NONE;
+}
+
+/**
+ \brief Calculate the FNV-1a hash of a key name
+
+ \param name The key name
+ \param length The key name length
+ \return The hash value
+ */
+uint32_t IRKeyMap::hash(const char* name, int length) {
+	uint32_t h = IR_HASH_SEED;
+
+	for(int j = 0; j < length; j++) {
+		h ^= (uint8_t)name[j];
+		h *= IR_HASH_PRIME;
+	}
+
+	return h;
+}
@@ -0,0 +1,50 @@
+/**
+\file IRKeyMap.h
+\brief Hash table matching the lirc codes with the IR controller key IDs.
+
+ The lirc code line has the format <code> <repeat> <key name> <remote name>.
+ The key name token is extracted and searched in a hash table built from the
+ IR_KEYS array, so every code is identified with a single hash and a single
+ string comparison. The comparison is exact, so a key name can't match a part
+ of a longer key name (e.g. KEY_UP and KEY_VOLUMEUP).
+
+ The hash is the FNV-1a with the IR_HASH_SEED offset basis, chosen so the
+ controller keys defined in ControllerKeys.h have no collisions in a table of
+ IR_HASH_SIZE slots. If the keys are changed and a collision happens the key
+ is stored in the next free slot, so the search remains correct.
+ */
+
+#include <stdint.h>
+
+#ifndef IRKEYMAP_H
+#define	IRKEYMAP_H
+
+//! Number of slots of the hash table. Should be a prime number greater
+//! than the number of keys
+#define IR_HASH_SIZE 53
+
+//! FNV-1a offset basis giving no collisions with the controller keys
+#define IR_HASH_SEED 0x811c9df2UL
+
+//! FNV-1a 32 bits prime
+#define IR_HASH_PRIME 16777619UL
+
+//! Key ID of the codes not matching any key
+#define IR_KEY_NONE -1
+
+class IRKeyMap {
+public:
+	IRKeyMap(const char* const* keys, int numKeys);
+	virtual ~IRKeyMap();
+	int find(const char* code);
+	int findKey(const char* name, int length);
+
+	static uint32_t hash(const char* name, int length);
+private:
+	//! The key names
+	const char* const* keyNames;
+	//! The key ID of every slot or IR_KEY_NONE for the empty slots
+	int slots[IR_HASH_SIZE];
+};
+
+#endif	/* IRKEYMAP_H */
@@ -6,13 +6,121 @@
  control panel board. This class is similar to the LCDTemplates used in the control
  panel board firmware but defines the templates content string for every field instead
  of the templates position elements.
+ 
+ All the templates are constants: the fields strings and the full template commands
+ are stored in the templatesTable, built at compile time. The layout errors (fields
+ longer than the LCD row or a command message, wrong number of fields) are detected
+ by the compile-time checks of this file and stop the build.
 */
 
 #include "LCDTemplatesMaster.h"
+#include "CommandParameters.h"
+#include <stddef.h>
+
+//! Compile-time check. The build fails with a negative array size error
+//! when the condition is false.
+#define TEMPLATE_CHECK(cond, name) typedef char name[(cond) ? 1 : -1]
+
+//! True if the field string fits in a command message string and in the LCD row
+#define FIELD_FITS(f) ( (sizeof(f) - 1 <= CMD_MSGLEN) && (sizeof(f) - 1 <= LCDCHARS) )
+
+//! Number of elements of a fields array
+#define NUM_ELEMENTS(a) (sizeof(a) / sizeof(a[0]))
+
+TEMPLATE_CHECK(TID_DEFAULT == MAX_TEMPLATES - 1, checkTemplatesCount);
+TEMPLATE_CHECK(MAX_TEMPLATES <= 10, checkTemplateIDDigits);
+
+//! TID_STETHOSCOPE template fields
+static const char* const stethoscopeFields[] = { STET_TITLE, STET_GAIN, STET_GAINVAL };
+TEMPLATE_CHECK(NUM_ELEMENTS(stethoscopeFields) == STETHOSCOPE_FIELDS, checkStethoscopeFieldsCount);
+TEMPLATE_CHECK(FIELD_FITS(STET_TITLE) && FIELD_FITS(STET_GAIN) && FIELD_FITS(STET_GAINVAL), checkStethoscopeFieldsLength);
+TEMPLATE_CHECK(sizeof(TID_STETHOSCOPE_FIELDID) - 1 == PARM_FIELDID_LEN, checkStethoscopeID);
+TEMPLATE_CHECK(sizeof(STETHOSCOPE_FRAME) - 1 <= MAX_FRAME_LEN, checkStethoscopeFrame);
+
+//! TID_BLOODPRESS template fields
+static const char* const bloodPressFields[] = { BLOOD_TITLE, BLOOD_WAIT, BLOOD_MIN, BLOOD_MINVAL, BLOOD_MAX, BLOOD_MAXVAL };
+TEMPLATE_CHECK(NUM_ELEMENTS(bloodPressFields) == BLOODPRESS_FIELDS, checkBloodPressFieldsCount);
+TEMPLATE_CHECK(
+	FIELD_FITS(BLOOD_TITLE) &&
+	FIELD_FITS(BLOOD_WAIT) &&
+	FIELD_FITS(BLOOD_MIN) &&
+	FIELD_FITS(BLOOD_MINVAL) &&
+	FIELD_FITS(BLOOD_MAX) &&
+	FIELD_FITS(BLOOD_MAXVAL), checkBloodPressFieldsLength);
+TEMPLATE_CHECK(sizeof(TID_BLOODPRESS_FIELDID) - 1 == PARM_FIELDID_LEN, checkBloodPressID);
+TEMPLATE_CHECK(sizeof(BLOODPRESS_FRAME) - 1 <= MAX_FRAME_LEN, checkBloodPressFrame);
 
-//! Defines the char array of the max number of fields in the
-//! template
-char *fields[] = { '\0', '\0', '\0', '\0', '\0', '\0' };
+//! TID_HEARTBEAT template fields
+static const char* const heartBeatFields[] = { HEARTBEAT_TITLE, HEARTBEAT_SPOT, HEARTBEAT_SPOTVAL, HEARTBEAT_AVERAGE, HEARTBEAT_AVERAGEVAL };
+TEMPLATE_CHECK(NUM_ELEMENTS(heartBeatFields) == HEARTBEAT_FIELDS, checkHeartBeatFieldsCount);
+TEMPLATE_CHECK(
+	FIELD_FITS(HEARTBEAT_TITLE) &&
+	FIELD_FITS(HEARTBEAT_SPOT) &&
+	FIELD_FITS(HEARTBEAT_SPOTVAL) &&
+	FIELD_FITS(HEARTBEAT_AVERAGE) &&
+	FIELD_FITS(HEARTBEAT_AVERAGEVAL), checkHeartBeatFieldsLength);
+TEMPLATE_CHECK(sizeof(TID_HEARTBEAT_FIELDID) - 1 == PARM_FIELDID_LEN, checkHeartBeatID);
+TEMPLATE_CHECK(sizeof(HEARTBEAT_FRAME) - 1 <= MAX_FRAME_LEN, checkHeartBeatFrame);
+
+//! TID_TEMPERATURE template fields
+static const char* const temperatureFields[] = { TEMPERATURE_TITLE, TEMPERATURE_SPOT, TEMPERATURE_SPOTVAL, TEMPERATURE_AVERAGE, TEMPERATURE_AVERAGEVAL };
+TEMPLATE_CHECK(NUM_ELEMENTS(temperatureFields) == TEMPERATURE_FIELDS, checkTemperatureFieldsCount);
+TEMPLATE_CHECK(
+	FIELD_FITS(TEMPERATURE_TITLE) &&
+	FIELD_FITS(TEMPERATURE_SPOT) &&
+	FIELD_FITS(TEMPERATURE_SPOTVAL) &&
+	FIELD_FITS(TEMPERATURE_AVERAGE) &&
+	FIELD_FITS(TEMPERATURE_AVERAGEVAL), checkTemperatureFieldsLength);
+TEMPLATE_CHECK(sizeof(TID_TEMPERATURE_FIELDID) - 1 == PARM_FIELDID_LEN, checkTemperatureID);
+TEMPLATE_CHECK(sizeof(TEMPERATURE_FRAME) - 1 <= MAX_FRAME_LEN, checkTemperatureFrame);
+
+//! TID_ECG template fields
+static const char* const ecgFields[] = { ECG_TITLE, ECG_STATUS, ECG_STATUSFLAG };
+TEMPLATE_CHECK(NUM_ELEMENTS(ecgFields) == ECG_FIELDS, checkEcgFieldsCount);
+TEMPLATE_CHECK(FIELD_FITS(ECG_TITLE) && FIELD_FITS(ECG_STATUS) && FIELD_FITS(ECG_STATUSFLAG), checkEcgFieldsLength);
+TEMPLATE_CHECK(sizeof(TID_ECG_FIELDID) - 1 == PARM_FIELDID_LEN, checkEcgID);
+TEMPLATE_CHECK(sizeof(ECG_FRAME) - 1 <= MAX_FRAME_LEN, checkEcgFrame);
+
+//! TID_TEST template fields
+static const char* const testFields[] = { TEST_TITLE, TEST_STATUS };
+TEMPLATE_CHECK(NUM_ELEMENTS(testFields) == TEST_FIELDS, checkTestFieldsCount);
+TEMPLATE_CHECK(FIELD_FITS(TEST_TITLE) && FIELD_FITS(TEST_STATUS), checkTestFieldsLength);
+TEMPLATE_CHECK(sizeof(TID_TEST_FIELDID) - 1 == PARM_FIELDID_LEN, checkTestID);
+TEMPLATE_CHECK(sizeof(TEST_FRAME) - 1 <= MAX_FRAME_LEN, checkTestFrame);
+
+//! TID_INFO template fields
+static const char* const infoFields[] = { INFO_TITLE, INFO_RPM, INFO_DATE, INFO_TIME, INFO_GPS };
+TEMPLATE_CHECK(NUM_ELEMENTS(infoFields) == INFO_FIELDS, checkInfoFieldsCount);
+TEMPLATE_CHECK(
+	FIELD_FITS(INFO_TITLE) &&
+	FIELD_FITS(INFO_RPM) &&
+	FIELD_FITS(INFO_DATE) &&
+	FIELD_FITS(INFO_TIME) &&
+	FIELD_FITS(INFO_GPS), checkInfoFieldsLength);
+TEMPLATE_CHECK(sizeof(TID_INFO_FIELDID) - 1 == PARM_FIELDID_LEN, checkInfoID);
+TEMPLATE_CHECK(sizeof(INFO_FRAME) - 1 <= MAX_FRAME_LEN, checkInfoFrame);
+TEMPLATE_CHECK((INFO_DATE_FIELD < INFO_FIELDS) && (INFO_TIME_FIELD < INFO_FIELDS), checkInfoClockFields);
+TEMPLATE_CHECK((sizeof(INFO_DATE) - 1 <= INFO_DATE_LEN) && (sizeof(INFO_TIME) - 1 <= INFO_TIME_LEN),
+	checkInfoClockLength);
+
+//! TID_DEFAULT template fields
+static const char* const defaultFields[] = { DEFAULT_TITLE, DEFAULT_VERSION, DEFAULT_STATUS };
+TEMPLATE_CHECK(NUM_ELEMENTS(defaultFields) == DEFAULT_FIELDS, checkDefaultFieldsCount);
+TEMPLATE_CHECK(FIELD_FITS(DEFAULT_TITLE) && FIELD_FITS(DEFAULT_VERSION) && FIELD_FITS(DEFAULT_STATUS), checkDefaultFieldsLength);
+TEMPLATE_CHECK(sizeof(TID_DEFAULT_FIELDID) - 1 == PARM_FIELDID_LEN, checkDefaultID);
+TEMPLATE_CHECK(sizeof(DEFAULT_FRAME) - 1 <= MAX_FRAME_LEN, checkDefaultFrame);
+
+//! The static templates table, in template ID order
+static const staticTemplate templatesTable[MAX_TEMPLATES] = {
+	{ STETHOSCOPE_FIELDS, stethoscopeFields, STETHOSCOPE_FRAME, sizeof(STETHOSCOPE_FRAME) - 1 },
+	{ BLOODPRESS_FIELDS, bloodPressFields, BLOODPRESS_FRAME, sizeof(BLOODPRESS_FRAME) - 1 },
+	{ HEARTBEAT_FIELDS, heartBeatFields, HEARTBEAT_FRAME, sizeof(HEARTBEAT_FRAME) - 1 },
+	{ TEMPERATURE_FIELDS, temperatureFields, TEMPERATURE_FRAME, sizeof(TEMPERATURE_FRAME) - 1 },
+	{ ECG_FIELDS, ecgFields, ECG_FRAME, sizeof(ECG_FRAME) - 1 },
+	{ TEST_FIELDS, testFields, TEST_FRAME, sizeof(TEST_FRAME) - 1 },
+	{ INFO_FIELDS, infoFields, INFO_FRAME, sizeof(INFO_FRAME) - 1 },
+	{ DEFAULT_FIELDS, defaultFields, DEFAULT_FRAME, sizeof(DEFAULT_FRAME) - 1 }
+};
 
 /**
 \brief Class constructor
@@ -60,6 +168,7 @@ int LCDTemplatesMaster::createDisplay(int templateID) {
 	if( (templateID >= 0 ) && (templateID < MAX_TEMPLATES) ) {
 		id = templateID;
 		nFields = createDisplay();
+		return nFields;
 	} // Assign the template fields
 	else
 		return -1; // Invalid template ID
@@ -75,70 +184,12 @@ int LCDTemplatesMaster::createDisplay(int templateID) {
  the current template ID is invalid
   */
 int LCDTemplatesMaster::createDisplay() {
-  int numFields;
-  
   // Check for the ID valid
   if( (id >= 0 ) && (id < MAX_TEMPLATES) ) {
-	  // Select the ID-based template
-	switch(id) {
-	  case TID_STETHOSCOPE:
-		fields[0] = (char*)STET_TITLE;
-		fields[1] = (char*)STET_GAIN;
-		fields[2] = (char*)STET_GAINVAL;
-		numFields = STETHOSCOPE_FIELDS;
-	  break;
-	  case TID_BLOODPRESS:
-		fields[0] = (char*)BLOOD_TITLE;
-		fields[1] = (char*)BLOOD_WAIT;
-		fields[2] = (char*)BLOOD_MIN;
-		fields[3] = (char*)BLOOD_MINVAL;
-		fields[4] = (char*)BLOOD_MAX;
-		fields[5] = (char*)BLOOD_MAXVAL;
-		numFields = BLOODPRESS_FIELDS;
-	  break;
-	  case TID_HEARTBEAT:
-		fields[0] = (char*)HEARTBEAT_TITLE;
-		fields[1] = (char*)HEARTBEAT_SPOT;
-		fields[2] = (char*)HEARTBEAT_SPOTVAL;
-		fields[3] = (char*)HEARTBEAT_AVERAGE;
-		fields[4] = (char*)HEARTBEAT_AVERAGEVAL;
-		numFields = HEARTBEAT_FIELDS;
-	  break;
-	  case TID_TEMPERATURE:
-		fields[0] = (char*)TEMPERATURE_TITLE;
-		fields[1] = (char*)TEMPERATURE_SPOT;
-		fields[2] = (char*)TEMPERATURE_SPOTVAL;
-		fields[3] = (char*)TEMPERATURE_AVERAGE;
-		fields[4] = (char*)TEMPERATURE_AVERAGEVAL;
-		numFields = TEMPERATURE_FIELDS;
-	  break;
-	  case TID_ECG:
-		fields[0] = (char*)ECG_TITLE;
-		fields[1] = (char*)ECG_STATUS;
-		fields[2] = (char*)ECG_STATUSFLAG;
-		numFields = ECG_FIELDS;
-	  break;
-	  case TID_TEST:
-		fields[0] = (char*)TEST_TITLE;
-		fields[1] = (char*)TEST_STATUS;
-		numFields = TEST_FIELDS;
-	  break;
-	  case TID_INFO:
-		fields[0] = (char*)INFO_TITLE;
-		fields[1] = (char*)INFO_RPM;
-		fields[2] = (char*)INFO_DATE;
-		fields[3] = (char*)INFO_TIME;
-		fields[4] = (char*)INFO_GPS;
-		numFields = INFO_FIELDS;
-	  break;
-	  case TID_DEFAULT:
-		fields[0] = (char*)DEFAULT_TITLE;
-		fields[1] = (char*)DEFAULT_VERSION;
-		fields[2] = (char*)DEFAULT_STATUS;
-		numFields = DEFAULT_FIELDS;
-	  break;
-	} // Assign the template fields
-	return numFields;
+	// Select the ID-based template
+	for(int j = 0; j < templatesTable[id].numFields; j++)
+		fields[j] = templatesTable[id].fields[j];
+	return templatesTable[id].numFields;
   }
   else
 	  return -1; // Template ID is invalid
@@ -157,8 +208,10 @@ int LCDTemplatesMaster::createDisplay() {
   \param val The string to update
   \param field The field ID
   */
-void LCDTemplatesMaster::updateDisplay(char *val, int fieldID) {
-  fields[fieldID] = val;
+void LCDTemplatesMaster::updateDisplay(const char *val, int fieldID) {
+  // Check for the field validity
+  if( (fieldID >= 0) && (fieldID < nFields) )
+	fields[fieldID] = val;
 }
 
 /**
@@ -179,13 +232,40 @@ int LCDTemplatesMaster::getNumFields() {
  \brief Return the requested field string
  
  \param f The desired field ID
- \return The corresponding string field or a null character if the requested field
- ID is out of range.
+ \return The corresponding string field or NULL if the requested field ID is out
+ of range.
  */
-char* LCDTemplatesMaster::getField(int f) {
+const char* LCDTemplatesMaster::getField(int f) {
 	// Check for the field validity
 	if( (f >= 0) && (f < nFields) )
 		return fields[f];
 	else
-		return CMD_NULLFIELD;
+		return NULL;
+}
+
+/**
+ \brief Return the default template command of the current template ID
+ 
+ The command is a compile-time constant and does not include the changes applied
+ by updateDisplay().
+ 
+ \return The template command or a null pointer if the current template ID is invalid.
+ The command is not null terminated, see getFrameLength()
+ */
+const char* LCDTemplatesMaster::getFrame() {
+	if( (id >= 0 ) && (id < MAX_TEMPLATES) )
+		return templatesTable[id].frame;
+	else
+		return NULL;
+}
+
+/**
+ \brief Return the number of bytes of the default template command of the
+ current template ID or 0 if the template ID is invalid
+ */
+int LCDTemplatesMaster::getFrameLength() {
+	if( (id >= 0 ) && (id < MAX_TEMPLATES) )
+		return templatesTable[id].frameLength;
+	else
+		return 0;
 }
@@ -13,18 +13,48 @@
 #ifndef __LCDTEMPLATESMASTER_H__
 #define __LCDTEMPLATESMASTER_H__
 
-//! Max number of templates
-#define MAX_TEMPLATES 7
+//! Max number of templates, including the default template
+#define MAX_TEMPLATES 8
 
 //! Largest field array. Corresponds to the largest
 //! possible template
-#define MAX_FIELDS 6;
+#define MAX_FIELDS 6
 
 //! Null character if a field shoul be empty
 #define CMD_NULLFIELD '\0'
 
+//! Display characters per line. No template field can be longer than the
+//! LCD row
+#define LCDCHARS 20
+
+/**
+ \brief Template field encoded in the command string format ;"<field>"
+ 
+ The template commands of the static templates are built by the preprocessor
+ concatenating the field strings so the full command is a string constant.
+ The string version of the FIELD_SEPARATOR and STRING_DELIMITER characters
+ is used.
+ */
+#define TEMPLATE_FIELD(f) ";\"" f "\""
+
+//! Stringize the value of a macro
+#define TID_DIGIT(id) #id
+
+/**
+ \brief Template ID encoded in the command string format, PARM_FIELDID_LEN digits
+ 
+ The string is built by the preprocessor from the numeric template ID, so the
+ IDs sent in the template commands always match the TID constants. The tens
+ digit is always 0: the IDs are less than 10 (see MAX_TEMPLATES).
+ */
+#define TID_STR(id) "0" TID_DIGIT(id)
+
+//! Template command header in the command string format @L;<template ID>
+#define TEMPLATE_HEADER(tid) "@L;" tid
+
 //! Microphonic stethoscope template
 #define TID_STETHOSCOPE 0
+#define TID_STETHOSCOPE_FIELDID TID_STR(TID_STETHOSCOPE)
 #define STETHOSCOPE_FIELDS 3
 #define STET_TITLE			"Stethoscope"
 #define STET_GAIN			"Gain"
@@ -32,6 +62,7 @@
 
 //! Blood pressure template parameters
 #define TID_BLOODPRESS 1
+#define TID_BLOODPRESS_FIELDID TID_STR(TID_BLOODPRESS)
 #define BLOODPRESS_FIELDS 6
 #define BLOOD_TITLE			"B. Pressure"
 #define BLOOD_WAIT			"Wait"
@@ -42,6 +73,7 @@
 
 //! Heartbeat frequency template
 #define TID_HEARTBEAT 2
+#define TID_HEARTBEAT_FIELDID TID_STR(TID_HEARTBEAT)
 #define HEARTBEAT_FIELDS 5
 #define HEARTBEAT_TITLE			"Heart Beat"
 #define HEARTBEAT_SPOT			"Spot"
@@ -51,6 +83,7 @@
 
 //! Temperature frequency template
 #define TID_TEMPERATURE 3
+#define TID_TEMPERATURE_FIELDID TID_STR(TID_TEMPERATURE)
 #define TEMPERATURE_FIELDS 5
 #define TEMPERATURE_TITLE		"Temperature"
 #define TEMPERATURE_SPOT		"Spot"
@@ -60,6 +93,7 @@
 
 //! Control panel E.C.G. template
 #define TID_ECG 4
+#define TID_ECG_FIELDID TID_STR(TID_ECG)
 #define ECG_FIELDS 3
 #define ECG_TITLE			"E.C.G."
 #define ECG_STATUS			"Status"
@@ -67,39 +101,97 @@
 
 //! Control panel test cycle template
 #define TID_TEST 5
+#define TID_TEST_FIELDID TID_STR(TID_TEST)
 #define TEST_FIELDS 2
 #define TEST_TITLE		"Control Panel"
 #define TEST_STATUS		"Test running"
 
 //! Control panel info template
 #define TID_INFO 6
+#define TID_INFO_FIELDID TID_STR(TID_INFO)
 #define INFO_FIELDS 5
 #define INFO_TITLE		"Info"
 #define INFO_RPM		"rpm"
-#define INFO_DATE		"dd/mm/yy"
+#define INFO_DATE		"dd/mm"
 #define INFO_TIME		"hh:mm"
 #define INFO_GPS		"GPS"
+//! Info template field showing the master date
+#define INFO_DATE_FIELD	2
+//! Info template field showing the master time
+#define INFO_TIME_FIELD	3
+//! Format of the master date and time fields (see strftime)
+#define INFO_DATE_FORMAT	"%d/%m"
+#define INFO_TIME_FORMAT	"%H:%M"
+//! Width of the board date and time fields: a longer string would overlap
+//! the next field
+#define INFO_DATE_LEN	5
+#define INFO_TIME_LEN	5
 
 //! Control panel default template
 #define TID_DEFAULT 7
+#define TID_DEFAULT_FIELDID TID_STR(TID_DEFAULT)
 #define DEFAULT_FIELDS 3
 #define DEFAULT_TITLE		"Meditech"
 #define DEFAULT_VERSION		"1.0"
 #define DEFAULT_STATUS		"running"
 
+//! Template command of the static templates, ready to be sent.
+//! The command ends with the CMD_TERMINATOR character.
+#define STETHOSCOPE_FRAME	TEMPLATE_HEADER(TID_STETHOSCOPE_FIELDID) TEMPLATE_FIELD(STET_TITLE) \
+	TEMPLATE_FIELD(STET_GAIN) TEMPLATE_FIELD(STET_GAINVAL) "\r"
+#define BLOODPRESS_FRAME	TEMPLATE_HEADER(TID_BLOODPRESS_FIELDID) TEMPLATE_FIELD(BLOOD_TITLE) \
+	TEMPLATE_FIELD(BLOOD_WAIT) TEMPLATE_FIELD(BLOOD_MIN) TEMPLATE_FIELD(BLOOD_MINVAL) \
+	TEMPLATE_FIELD(BLOOD_MAX) TEMPLATE_FIELD(BLOOD_MAXVAL) "\r"
+#define HEARTBEAT_FRAME		TEMPLATE_HEADER(TID_HEARTBEAT_FIELDID) TEMPLATE_FIELD(HEARTBEAT_TITLE) \
+	TEMPLATE_FIELD(HEARTBEAT_SPOT) TEMPLATE_FIELD(HEARTBEAT_SPOTVAL) \
+	TEMPLATE_FIELD(HEARTBEAT_AVERAGE) TEMPLATE_FIELD(HEARTBEAT_AVERAGEVAL) "\r"
+#define TEMPERATURE_FRAME	TEMPLATE_HEADER(TID_TEMPERATURE_FIELDID) TEMPLATE_FIELD(TEMPERATURE_TITLE) \
+	TEMPLATE_FIELD(TEMPERATURE_SPOT) TEMPLATE_FIELD(TEMPERATURE_SPOTVAL) \
+	TEMPLATE_FIELD(TEMPERATURE_AVERAGE) TEMPLATE_FIELD(TEMPERATURE_AVERAGEVAL) "\r"
+#define ECG_FRAME			TEMPLATE_HEADER(TID_ECG_FIELDID) TEMPLATE_FIELD(ECG_TITLE) \
+	TEMPLATE_FIELD(ECG_STATUS) TEMPLATE_FIELD(ECG_STATUSFLAG) "\r"
+#define TEST_FRAME			TEMPLATE_HEADER(TID_TEST_FIELDID) TEMPLATE_FIELD(TEST_TITLE) \
+	TEMPLATE_FIELD(TEST_STATUS) "\r"
+#define INFO_FRAME			TEMPLATE_HEADER(TID_INFO_FIELDID) TEMPLATE_FIELD(INFO_TITLE) \
+	TEMPLATE_FIELD(INFO_RPM) TEMPLATE_FIELD(INFO_DATE) TEMPLATE_FIELD(INFO_TIME) \
+	TEMPLATE_FIELD(INFO_GPS) "\r"
+#define DEFAULT_FRAME		TEMPLATE_HEADER(TID_DEFAULT_FIELDID) TEMPLATE_FIELD(DEFAULT_TITLE) \
+	TEMPLATE_FIELD(DEFAULT_VERSION) TEMPLATE_FIELD(DEFAULT_STATUS) "\r"
+
+/**
+ \brief Static template definition
+ 
+ All the template contents are constants so the templates table, including the
+ full template command, is built at compile time.
+ */
+typedef struct LCDStaticTemplate {
+	//! The number of template fields
+	int numFields;
+	//! The default field strings
+	const char* const* fields;
+	//! The full template command
+	const char* frame;
+	//! The template command length
+	int frameLength;
+} staticTemplate;
+
 class LCDTemplatesMaster {
   public:
 	  LCDTemplatesMaster(int templateID);
 	  LCDTemplatesMaster();
 	  int createDisplay();
 	  int createDisplay(int templateID);
-	  void updateDisplay(char* val, int fieldID);
+	  void updateDisplay(const char* val, int fieldID);
 	  int getID();
 	  int getNumFields();
-	  char* getField(int f);
+	  const char* getField(int f);
+	  const char* getFrame();
+	  int getFrameLength();
   private:
 	  int id;
 	  int nFields;
+	  //! The current field strings
+	  const char* fields[MAX_FIELDS];
 };
 
 #endif
@@ -0,0 +1,383 @@
+/**
+ \file LinkProtocol.cpp
+ \brief LinkFrame class builds and decodes the binary protocol frames.
+
+ \warning This file should be identical to the corresponding file of the control
+ panel firmware.
+ */
+
+#include "LinkProtocol.h"
+#include <string.h>
+
+/**
+ \brief Constructor method
+ */
+LinkFrame::LinkFrame() {
+	length = 0;
+	readPos = 0;
+}
+
+/**
+ \brief Start a new frame
+
+ \param type The frame type (the command character)
+ \param sequence The sequence ID of the request or LINK_NO_SEQUENCE
+ */
+void LinkFrame::begin(char type, uint8_t sequence) {
+	payload[0] = (uint8_t)type;
+	payload[1] = sequence;
+	length = LINK_HEADER_LEN;
+	readPos = LINK_HEADER_LEN;
+}
+
+/**
+ \brief Add an unsigned 8 bits integer field
+
+ \return false if there is no more room in the frame
+ */
+bool LinkFrame::addUInt8(uint8_t value) {
+	return addBytes(LINK_FIELD_UINT8, &value, 1);
+}
+
+/**
+ \brief Add a signed 16 bits integer field
+ */
+bool LinkFrame::addInt16(int16_t value) {
+	uint8_t bytes[2];
+
+	bytes[0] = (uint8_t)((uint16_t)value >> 8);
+	bytes[1] = (uint8_t)value;
+
+	return addBytes(LINK_FIELD_INT16, bytes, 2);
+}
+
+/**
+ \brief Add a signed 32 bits integer field
+ */
+bool LinkFrame::addInt32(int32_t value) {
+	uint8_t bytes[4];
+	uint32_t v = (uint32_t)value;
+
+	for(int j = 3; j >= 0; j--) {
+		bytes[j] = (uint8_t)v;
+		v >>= 8;
+	}
+
+	return addBytes(LINK_FIELD_INT32, bytes, 4);
+}
+
+/**
+ \brief Add a float field
+ */
+bool LinkFrame::addFloat(float value) {
+	uint8_t bytes[4];
+	uint32_t v;
+
+	memcpy(&v, &value, 4);
+	for(int j = 3; j >= 0; j--) {
+		bytes[j] = (uint8_t)v;
+		v >>= 8;
+	}
+
+	return addBytes(LINK_FIELD_FLOAT, bytes, 4);
+}
+
+/**
+ \brief Add a boolean field
+ */
+bool LinkFrame::addBool(bool value) {
+	uint8_t v = value ? 1 : 0;
+
+	return addBytes(LINK_FIELD_BOOL, &v, 1);
+}
+
+/**
+ \brief Add a string field
+
+ \param value The null terminated string. Strings longer than 255 characters
+ are rejected.
+ */
+bool LinkFrame::addString(const char* value) {
+	int stringLength = strlen(value);
+
+	if(stringLength > 255)
+		return false;
+	if(length + 2 + stringLength > LINK_MAX_PAYLOAD - LINK_CRC_LEN)
+		return false;
+
+	payload[length++] = LINK_FIELD_STRING;
+	payload[length++] = (uint8_t)stringLength;
+	memcpy(payload + length, value, stringLength);
+	length += stringLength;
+
+	return true;
+}
+
+/**
+ \brief Encode the frame ready to be sent
+
+ The CRC is added to the payload, then the payload is COBS encoded and enclosed
+ between two LINK_DELIMITER bytes.
+
+ \param buffer The destination buffer
+ \param bufferLength The destination buffer size
+ \return The number of encoded bytes or -1 if the buffer is too small
+ */
+int LinkFrame::encode(uint8_t* buffer, int bufferLength) {
+	uint16_t crc = crc16(payload, length);
+	uint8_t data[LINK_MAX_PAYLOAD];
+	int dataLength = length + LINK_CRC_LEN;
+	int outPos;
+	int codePos;
+	uint8_t code;
+
+	if(bufferLength < dataLength + (dataLength / 254) + 3)
+		return -1;
+
+	memcpy(data, payload, length);
+	data[length] = (uint8_t)(crc >> 8);
+	data[length + 1] = (uint8_t)crc;
+
+	// COBS encoding: every block starts with the distance of the next zero
+	buffer[0] = LINK_DELIMITER;
+	codePos = 1;
+	outPos = 2;
+	code = 1;
+	for(int j = 0; j < dataLength; j++) {
+		if(data[j] == 0) {
+			buffer[codePos] = code;
+			codePos = outPos++;
+			code = 1;
+		} // Zero byte: close the block
+		else {
+			buffer[outPos++] = data[j];
+			code++;
+			if(code == 0xFF) {
+				buffer[codePos] = code;
+				codePos = outPos++;
+				code = 1;
+			} // Max block length
+		} // Data byte
+	}
+	buffer[codePos] = code;
+	buffer[outPos++] = LINK_DELIMITER;
+
+	return outPos;
+}
+
+/**
+ \brief Decode a received frame
+
+ \param buffer The COBS encoded bytes received between the two delimiters
+ \param bufferLength The number of received bytes
+ \return true if the frame is valid (COBS encoding and CRC), else false
+ */
+bool LinkFrame::decode(const uint8_t* buffer, int bufferLength) {
+	int inPos = 0;
+	int outPos = 0;
+	uint8_t code;
+	uint16_t crc;
+
+	while(inPos < bufferLength) {
+		code = buffer[inPos++];
+		if( (code == 0) || (inPos + code - 1 > bufferLength) )
+			return false;
+
+		for(int j = 1; j < code; j++) {
+			if(outPos >= LINK_MAX_PAYLOAD)
+				return false;
+			payload[outPos++] = buffer[inPos++];
+		}
+
+		// A block shorter than 0xFF is followed by a zero, except the last one
+		if( (code != 0xFF) && (inPos < bufferLength) ) {
+			if(outPos >= LINK_MAX_PAYLOAD)
+				return false;
+			payload[outPos++] = 0;
+		}
+	} // Decode the blocks
+
+	if(outPos < LINK_HEADER_LEN + LINK_CRC_LEN)
+		return false;
+
+	length = outPos - LINK_CRC_LEN;
+	readPos = LINK_HEADER_LEN;
+	crc = ((uint16_t)payload[length] << 8) | payload[length + 1];
+
+	return crc == crc16(payload, length);
+}
+
+/**
+ \brief Return the frame type (the command character)
+ */
+char LinkFrame::getType() {
+	return length > 0 ? (char)payload[0] : 0;
+}
+
+/**
+ \brief Return the sequence ID of the frame
+ */
+uint8_t LinkFrame::getSequence() {
+	return length > 1 ? payload[1] : LINK_NO_SEQUENCE;
+}
+
+/**
+ \brief Change the sequence ID of a built or decoded frame
+ 
+ The CRC is calculated when the frame is encoded so the frame can be
+ encoded again with the new sequence ID.
+ */
+void LinkFrame::setSequence(uint8_t sequence) {
+	if(length > 1)
+		payload[1] = sequence;
+}
+/**
+ \brief Read the next field as an unsigned 8 bits integer
+
+ \return false if the next field has a different type or the frame ends
+ */
+bool LinkFrame::readUInt8(uint8_t& value) {
+	return readBytes(LINK_FIELD_UINT8, &value, 1);
+}
+
+/**
+ \brief Read the next field as a signed 16 bits integer
+ */
+bool LinkFrame::readInt16(int16_t& value) {
+	uint8_t bytes[2];
+
+	if(!readBytes(LINK_FIELD_INT16, bytes, 2))
+		return false;
+
+	value = (int16_t)(((uint16_t)bytes[0] << 8) | bytes[1]);
+	return true;
+}
+
+/**
+ \brief Read the next field as a signed 32 bits integer
+ */
+bool LinkFrame::readInt32(int32_t& value) {
+	uint8_t bytes[4];
+	uint32_t v = 0;
+
+	if(!readBytes(LINK_FIELD_INT32, bytes, 4))
+		return false;
+
+	for(int j = 0; j < 4; j++)
+		v = (v << 8) | bytes[j];
+
+	value = (int32_t)v;
+	return true;
+}
+
+/**
+ \brief Read the next field as a float
+ */
+bool LinkFrame::readFloat(float& value) {
+	uint8_t bytes[4];
+	uint32_t v = 0;
+
+	if(!readBytes(LINK_FIELD_FLOAT, bytes, 4))
+		return false;
+
+	for(int j = 0; j < 4; j++)
+		v = (v << 8) | bytes[j];
+
+	memcpy(&value, &v, 4);
+	return true;
+}
+
+/**
+ \brief Read the next field as a boolean
+ */
+bool LinkFrame::readBool(bool& value) {
+	uint8_t v;
+
+	if(!readBytes(LINK_FIELD_BOOL, &v, 1))
+		return false;
+
+	value = v != 0;
+	return true;
+}
+
+/**
+ \brief Read the next field as a string
+
+ \param value The destination buffer. The string is null terminated
+ \param maxLength The destination buffer size
+ \return false if the next field is not a string or the string does not fit
+ the destination buffer
+ */
+bool LinkFrame::readString(char* value, int maxLength) {
+	int stringLength;
+
+	if( (readPos + 2 > length) || (payload[readPos] != LINK_FIELD_STRING) )
+		return false;
+
+	stringLength = payload[readPos + 1];
+	if( (readPos + 2 + stringLength > length) || (stringLength >= maxLength) )
+		return false;
+
+	memcpy(value, payload + readPos + 2, stringLength);
+	value[stringLength] = '\0';
+	readPos += 2 + stringLength;
+
+	return true;
+}
+
+/**
+ \brief Check if all the frame fields have been read
+ */
+bool LinkFrame::isEnd() {
+	return readPos >= length;
+}
+
+/**
+ \brief Calculate the CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF)
+
+ \param data The data bytes
+ \param length The number of bytes
+ \return The CRC value
+ */
+uint16_t LinkFrame::crc16(const uint8_t* data, int length) {
+	uint16_t crc = 0xFFFF;
+
+	for(int j = 0; j < length; j++) {
+		crc ^= (uint16_t)data[j] << 8;
+		for(int b = 0; b < 8; b++) {
+			if(crc & 0x8000)
+				crc = (crc << 1) ^ 0x1021;
+			else
+				crc <<= 1;
+		}
+	}
+
+	return crc;
+}
+
+/**
+ \brief Append a fixed length field to the payload
+ */
+bool LinkFrame::addBytes(char type, const uint8_t* bytes, int count) {
+	if(length + 1 + count > LINK_MAX_PAYLOAD - LINK_CRC_LEN)
+		return false;
+
+	payload[length++] = (uint8_t)type;
+	memcpy(payload + length, bytes, count);
+	length += count;
+
+	return true;
+}
+
+/**
+ \brief Read a fixed length field from the payload
+ */
+bool LinkFrame::readBytes(char type, uint8_t* bytes, int count) {
+	if( (readPos + 1 + count > length) || (payload[readPos] != (uint8_t)type) )
+		return false;
+
+	memcpy(bytes, payload + readPos + 1, count);
+	readPos += 1 + count;
+
+	return true;
+}
@@ -17,14 +17,25 @@
 #ifndef MESSAGE_STRINGS_H
 #define	MESSAGE_STRINGS_H
 
-#define SSH_AUDIO_MESSAGE_PATH "/home/pi/remote_message.sh"
-#define SSH_AUDIO_MESSAGE "remote_message.sh"
-
-#define SSH_FOLDER_MOUNT_PATH "/home/pi/remote_mount.sh"
-#define SSH_FOLDER_MOUNT "remote_mount.sh"
-
-#define SSH_FOLDER_UMOUNT_PATH "/home/pi/remote_umount.sh"
-#define SSH_FOLDER_UMOUNT "remote_mount.sh"
+//! The remote player host. The voice messages are played with a single ssh
+//! connection shared by all the messages. If the host is empty the messages
+//! are played locally (used for testing without the remote player).
+#define AUDIO_REMOTE_HOST "pi@RPIslave3"
+//! The ssh control socket of the shared connection
+#define AUDIO_CONTROL_SOCKET "/tmp/meditech_audio.ssh"
+//! The audio player command, on the remote host. The audio data is sent
+//! to the player standard input
+#define AUDIO_PLAYER "aplay"
+//! The decoder of the IMA-ADPCM encoded messages, on the remote host (see
+//! AudioDecoder.cpp). Reads the encoded stream from the standard input and
+//! writes the wav stream to the standard output
+#define AUDIO_DECODER "/home/pi/meditech_audiodecoder"
+//! The remote shell command playing the wav messages
+#define AUDIO_PLAY_COMMAND AUDIO_PLAYER " -q"
+//! The remote shell command playing the IMA-ADPCM encoded messages
+#define AUDIO_DECODE_COMMAND AUDIO_DECODER " | " AUDIO_PLAYER " -q"
+//! The voice messages pack mapped by the audio worker
+#define AUDIO_PACK TTS_FOLDER TTS_PACK
 
 //! The audio files folder, under the pi home folder
 #define TTS_FOLDER	"/home/pi/tts_audio_messages/"
@@ -40,6 +51,21 @@
 //! The max number of message strings
 #define TTS_MAX_MESSAGES 27
 
+//! The file with the hashes of the converted strings, in the TTS_FOLDER
+#define TTS_MANIFEST "tts_manifest"
+
+//! The pack of all the audio files, in the TTS_FOLDER
+#define TTS_PACK "tts_messages.pack"
+
+//! Store the messages in the pack encoded with IMA-ADPCM
+#define TTS_USE_ADPCM true
+
+//! Number of times every message is encoded and decoded by the bench
+#define TTS_BENCH_REPEAT 20
+
+//! Sample rate of the test clip used by the bench if no message exists
+#define TTS_BENCH_RATE 16000
+
 //! The shell command string length (max)
 #define MAX_SHELL_CMD_LEN 1024
 
@@ -56,6 +82,47 @@
 //! Error message when spawning the process to start festival
 #define TTS_SPAWN_ERROR "\n*** ERROR Spawining the main process ***\n"
 
+//! Error message when a message conversion fails (message number)
+#define TTS_JOB_FAILED "\n*** ERROR Converting the message %d ***\n"
+
+//! Error message when the TTS manifest can't be written
+#define TTS_MANIFEST_ERROR "\n*** ERROR Writing the TTS manifest ***\n"
+
+//! Error message when the voice messages pack can't be built
+#define TTS_PACK_ERROR "\n*** ERROR Building the voice messages pack ***\n"
+
+//! Bench table header
+#define TTS_BENCH_HEADER "\n%-8s %10s %10s %6s %10s %10s %8s\n", "Message", "PCM bytes", "ADPCM", "Ratio", "Enc us", "Dec us", "SNR dB"
+//! Bench table row (message, PCM bytes, ADPCM bytes, ratio, encode us, decode us, SNR)
+#define TTS_BENCH_ROW "%-8s %10u %10u %6.2f %10.0f %10.0f %8.1f\n"
+//! Bench message when no voice message exists
+#define TTS_BENCH_SYNTHETIC "\nNo voice messages found, using a test clip\n"
+
+//! TTS process result message (converted messages, failed messages)
+#define TTS_RESULT "\n%d messages converted, %d failed\n"
+
+//! Error message when the audio messages worker can't be started
+#define AUDIO_WORKER_ERROR "\n*** ERROR Starting the audio messages process ***\n"
+
+//! Error message when the audio messages worker ends too many times
+#define AUDIO_WORKER_GIVEUP "\n*** Audio messages process ended too many times. Not restarted ***\n"
+
+//! Error message when the voice messages pack can't be mapped
+#define AUDIO_PACK_ERROR "\n*** ERROR Opening the voice messages pack ***\n"
+
+//! Error message when a command can't be queued for the control panel
+#define SERIAL_QUEUE_FULL "\n*** Serial queue full. Command discarded ***\n"
+
+//! Startup report header
+#define STARTUP_REPORT_HEADER "\n%-8s %-8s %10s %10s\n", "Step", "Status", "Start ms", "Time ms"
+//! Startup report step row (step, status, start from the boot, duration)
+#define STARTUP_REPORT_STEP "%-8s %-8s %10ld %10ld\n"
+//! Startup report total (startup time, time from the boot)
+#define STARTUP_REPORT_TOTAL "Startup completed in %ld ms, %ld ms from the boot\n"
+
+//! Error message when the control panel does not respond to a command
+#define SERIAL_RESPONSE_TIMEOUT "\n*** No response from the control panel ***\n"
+
 // Strings array IDs
 #define TTS_SYSTEM_RESTARTED 0
 #define TTS_POWER_OFF 1
@@ -85,5 +152,19 @@
 #define TTS_PROBE_STOPPED 25
 #define TTS_CONTINUOUS_ON 26
 
+// Voice message classes. A new message replaces the waiting or playing
+// message of the same class, as it reports a more recent status.
+//! Power status messages. Played before all the other messages
+#define AUDIO_CLASS_POWER 0
+//! Voice messages status (mute)
+#define AUDIO_CLASS_VOICE 1
+//! Probes status
+#define AUDIO_CLASS_PROBE 2
+//! System and control panel status
+#define AUDIO_CLASS_SYSTEM 3
+
+//! Time within a repeated message is ignored (ms)
+#define AUDIO_DEDUPE_WINDOW 1500
+
 #endif	/* MESSAGE_STRINGS_H */
 
@@ -30,6 +30,8 @@
 #define COMMAND_BODYTEMP_PARAMERROR 8
 #define COMMAND_HEARTBEAT_PARAMERROR 9
 #define COMMAND_WRONG_TEMPLATE 10
+//! A binary frame has been received with a wrong CRC or encoding
+#define COMMAND_FRAME_ERROR 11
 
 #endif
 
@@ -0,0 +1,119 @@
+/**
+ \file RequestTracker.cpp
+ \brief RequestTracker class assigns the sequence IDs to the commands sent to
+ the control panel board and matches the responses with the requests.
+ */
+
+#include "RequestTracker.h"
+#include "EventLoop.h"
+
+/**
+ \brief Constructor method
+ */
+RequestTracker::RequestTracker() {
+	nextSequence = 0;
+	clear();
+}
+
+/**
+ \brief Destructor method
+ */
+RequestTracker::~RequestTracker() {
+}
+
+/**
+ \brief Reserve a window slot for a command being sent
+
+ The sequence IDs are assigned in rotation from 0 to MAX_SEQUENCE - 1. As the
+ window is much smaller than the sequence range, the IDs of the commands waiting
+ for the response are always unique.
+
+ \return The sequence ID to send with the command or NO_SEQUENCE if the
+ window is full
+ */
+int RequestTracker::open() {
+	if(isFull())
+		return NO_SEQUENCE;
+
+	for(int j = 0; j < IN_FLIGHT_WINDOW; j++) {
+		if(!window[j].isActive) {
+			window[j].isActive = true;
+			window[j].sequence = nextSequence;
+			window[j].sentTime = EventLoop::currentTime();
+			nextSequence = (nextSequence + 1) % MAX_SEQUENCE;
+			count++;
+			return window[j].sequence;
+		} // Free slot
+	} // Search a free slot
+
+	return NO_SEQUENCE;
+}
+
+/**
+ \brief Release the slot of the command with the received response
+
+ \param sequence The sequence ID of the response
+ \return true if the command was waiting, false for unknown, expired or
+ already acknowledged sequence IDs
+ */
+bool RequestTracker::acknowledge(int sequence) {
+	for(int j = 0; j < IN_FLIGHT_WINDOW; j++) {
+		if(window[j].isActive && (window[j].sequence == sequence)) {
+			window[j].isActive = false;
+			count--;
+			return true;
+		} // Found the command
+	} // Search the sequence ID
+
+	return false;
+}
+
+/**
+ \brief Release the slots of the commands waiting longer than IN_FLIGHT_TIMEOUT
+
+ \return The number of expired commands
+ */
+int RequestTracker::expire() {
+	long now = EventLoop::currentTime();
+	int expired = 0;
+
+	for(int j = 0; j < IN_FLIGHT_WINDOW; j++) {
+		if(window[j].isActive && (now - window[j].sentTime >= IN_FLIGHT_TIMEOUT)) {
+			window[j].isActive = false;
+			count--;
+			expired++;
+		} // No response in time
+	} // Check all the slots
+
+	return expired;
+}
+
+/**
+ \brief Check if no commands are waiting for the response
+ */
+bool RequestTracker::isEmpty() {
+	return count == 0;
+}
+
+/**
+ \brief Check if the window has no more free slots
+ */
+bool RequestTracker::isFull() {
+	return count == IN_FLIGHT_WINDOW;
+}
+
+/**
+ \brief Return the number of commands waiting for the response
+ */
+int RequestTracker::getCount() {
+	return count;
+}
+
+/**
+ \brief Release all the slots
+ */
+void RequestTracker::clear() {
+	for(int j = 0; j < IN_FLIGHT_WINDOW; j++)
+		window[j].isActive = false;
+	count = 0;
+}
@@ -0,0 +1,56 @@
+/**
+\file RequestTracker.h
+\brief In-flight table of the commands sent to the control panel board and
+ still waiting for the response.
+
+ Every command sent to the board is tagged with a sequence ID that the board
+ echoes in its response. Up to IN_FLIGHT_WINDOW commands can wait for their
+ response at the same time, so the next commands are sent without waiting the
+ serial round trip of the previous ones. When the window is full the commands
+ remain in the pending queue until a response (or a timeout) frees a slot.
+ */
+
+#include "CommandParameters.h"
+
+#ifndef REQUESTTRACKER_H
+#define	REQUESTTRACKER_H
+
+//! Max number of commands waiting for the response
+#define IN_FLIGHT_WINDOW 4
+
+//! Time after which a command with no response is discarded (ms)
+#define IN_FLIGHT_TIMEOUT 500
+
+/**
+ \brief A command waiting for the response
+ */
+typedef struct InFlightCommand {
+	//! The slot is in use
+	bool isActive;
+	//! The sequence ID sent with the command
+	int sequence;
+	//! The time the command has been sent (ms)
+	long sentTime;
+} inFlightCommand;
+
+class RequestTracker {
+public:
+	RequestTracker();
+	virtual ~RequestTracker();
+	int open();
+	bool acknowledge(int sequence);
+	int expire();
+	bool isEmpty();
+	bool isFull();
+	int getCount();
+	void clear();
+private:
+	//! The in-flight commands window
+	inFlightCommand window[IN_FLIGHT_WINDOW];
+	//! Number of commands waiting for the response
+	int count;
+	//! The sequence ID assigned to the next command
+	int nextSequence;
+};
+
+#endif	/* REQUESTTRACKER_H */
@@ -0,0 +1,169 @@
+/**
+ \file SerialQueue.cpp
+ \brief SerialQueue class manages the outbound commands ring buffer and the
+ non-blocking writes to the UART.
+ */
+
+#include "SerialQueue.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ \brief Constructor method
+ */
+SerialQueue::SerialQueue() {
+	clear();
+}
+
+/**
+ \brief Destructor method
+ */
+SerialQueue::~SerialQueue() {
+}
+
+/**
+ \brief Copy a command frame at the end of the queue
+
+ \param data The frame bytes
+ \param length The number of bytes of the frame
+ \return false if the queue is full or the frame is too long, else true
+ */
+bool SerialQueue::push(const char* data, int length) {
+	if( isFull() || (length <= 0) || (length > SERIAL_FRAME_LEN) )
+		return false;
+
+	memcpy(frames[tail].data, data, length);
+	frames[tail].length = length;
+
+	tail = (tail + 1) % SERIAL_QUEUE_SIZE;
+	count++;
+
+	return true;
+}
+
+/**
+ \brief Copy a command frame at the end of the queue
+
+ \param frame The command frame. Only the valid frame bytes are queued
+ \return false if the queue is full, else true
+ */
+bool SerialQueue::push(const commandFrame& frame) {
+	return push(frame.data, frame.length);
+}
+
+/**
+ \brief Remove the first frame from the queue copying it in the caller frame
+
+ \param frame The destination frame
+ \return false if the queue is empty
+ */
+bool SerialQueue::pop(commandFrame& frame) {
+	if(isEmpty())
+		return false;
+
+	memcpy(frame.data, frames[head].data, frames[head].length);
+	frame.length = frames[head].length;
+	pop();
+
+	return true;
+}
+
+/**
+ \brief Write the queued frames to a non-blocking file descriptor
+
+ All the queued frames are gathered in a single writev() call. When the
+ descriptor accepts only a part of the bytes the remaining are kept and
+ sent by the next call, starting from the first byte not yet written.
+
+ \param fd The non-blocking file descriptor (the UART)
+ \return The number of bytes written, 0 if the descriptor can't accept more
+ bytes or -1 on write errors.
+ */
+int SerialQueue::flush(int fd) {
+	struct iovec iov[SERIAL_QUEUE_SIZE];
+	int totalBytes = 0;
+	ssize_t written;
+	int nIov;
+	int pos;
+
+	while(!isEmpty()) {
+		// Gather the waiting frames, the first one from the bytes not yet sent
+		pos = head;
+		for(nIov = 0; nIov < count; nIov++) {
+			iov[nIov].iov_base = frames[pos].data;
+			iov[nIov].iov_len = frames[pos].length;
+			pos = (pos + 1) % SERIAL_QUEUE_SIZE;
+		}
+		iov[0].iov_base = frames[head].data + sentBytes;
+		iov[0].iov_len = frames[head].length - sentBytes;
+
+		written = writev(fd, iov, nIov);
+		if(written == -1) {
+			if(errno == EINTR)
+				continue;
+			if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
+				break;
+			return -1;
+		} // Write error
+		if(written == 0)
+			break;
+
+		totalBytes += written;
+
+		// Remove the frames completely written
+		while( (written > 0) && !isEmpty() ) {
+			int remaining = frames[head].length - sentBytes;
+			if(written >= remaining) {
+				written -= remaining;
+				pop();
+			} // Frame sent
+			else {
+				sentBytes += written;
+				written = 0;
+			} // Frame partially sent
+		}
+	} // Write until the queue is empty or the descriptor is full
+
+	return totalBytes;
+}
+
+/**
+ \brief Check if there are no frames waiting
+ */
+bool SerialQueue::isEmpty() {
+	return count == 0;
+}
+
+/**
+ \brief Check if there is no more room for frames
+ */
+bool SerialQueue::isFull() {
+	return count == SERIAL_QUEUE_SIZE;
+}
+
+/**
+ \brief Return the number of frames waiting to be sent
+ */
+int SerialQueue::getCount() {
+	return count;
+}
+
+/**
+ \brief Discard all the waiting frames
+ */
+void SerialQueue::clear() {
+	head = 0;
+	tail = 0;
+	count = 0;
+	sentBytes = 0;
+}
+
+/**
+ \brief Remove the first frame from the queue
+ */
+void SerialQueue::pop() {
+	head = (head + 1) % SERIAL_QUEUE_SIZE;
+	count--;
+	sentBytes = 0;
+}
@@ -0,0 +1,61 @@
+/**
+\file SerialQueue.h
+\brief Bounded queue of the commands waiting to be sent to the control panel board.
+
+ The queue is a ring buffer of frames owned by the queue: every command is copied
+ when it is queued so the caller buffer can be reused immediately. The UART is opened
+ in non-blocking mode so a write can accept only a part of the waiting bytes; the
+ queue takes track of the bytes already sent of the first frame and the next flush
+ resumes from the first byte not yet written.
+ */
+
+#include "CommandParameters.h"
+#include <sys/uio.h>
+
+#ifndef SERIALQUEUE_H
+#define	SERIALQUEUE_H
+
+//! Max number of commands waiting to be sent
+#define SERIAL_QUEUE_SIZE 16
+
+//! Max length of a queued frame
+#define SERIAL_FRAME_LEN MAX_FRAME_LEN
+
+/**
+ \brief A command frame owned by the queue
+ */
+typedef struct SerialQueueFrame {
+	//! The frame bytes
+	char data[SERIAL_FRAME_LEN];
+	//! Number of valid bytes in the frame
+	int length;
+} queuedFrame;
+
+class SerialQueue {
+public:
+	SerialQueue();
+	virtual ~SerialQueue();
+	bool push(const char* data, int length);
+	bool push(const commandFrame& frame);
+	bool pop(commandFrame& frame);
+	int flush(int fd);
+	bool isEmpty();
+	bool isFull();
+	int getCount();
+	void clear();
+private:
+	//! The frames ring buffer
+	queuedFrame frames[SERIAL_QUEUE_SIZE];
+	//! Position of the first frame to send
+	int head;
+	//! Position of the next free frame
+	int tail;
+	//! Number of queued frames
+	int count;
+	//! Bytes of the head frame already written to the UART
+	int sentBytes;
+
+	void pop();
+};
+
+#endif	/* SERIALQUEUE_H */
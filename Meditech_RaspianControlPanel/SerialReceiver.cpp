@@ -0,0 +1,209 @@
+/**
+ \file SerialReceiver.cpp
+ \brief SerialReceiver class reads the characters from the UART and splits
+ them in the lines and binary frames sent by the control panel board.
+ */
+
+#include "SerialReceiver.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ \brief Constructor method
+ */
+SerialReceiver::SerialReceiver() {
+	clear();
+}
+
+/**
+ \brief Destructor method
+ */
+SerialReceiver::~SerialReceiver() {
+}
+
+/**
+ \brief Read all the characters waiting on a non-blocking file descriptor
+
+ The characters are appended to the ring buffer until the descriptor has
+ no more characters or the buffer is full.
+
+ \param fd The non-blocking file descriptor (the UART)
+ \return The number of characters read, 0 if there are no characters or the
+ buffer is full, -1 on read errors
+ */
+int SerialReceiver::receive(int fd) {
+	int totalBytes = 0;
+	int tail;
+	int chunk;
+	ssize_t received;
+
+	while(count < RX_BUFFER_SIZE) {
+		// Read in the contiguous free space after the last character
+		tail = (head + count) % RX_BUFFER_SIZE;
+		chunk = RX_BUFFER_SIZE - count;
+		if(tail + chunk > RX_BUFFER_SIZE)
+			chunk = RX_BUFFER_SIZE - tail;
+
+		received = read(fd, buffer + tail, chunk);
+		if(received == -1) {
+			if(errno == EINTR)
+				continue;
+			if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
+				break;
+			return -1;
+		} // Read error
+		if(received == 0)
+			break;
+
+		count += received;
+		totalBytes += received;
+	} // Read until the descriptor is empty or the buffer is full
+
+	return totalBytes;
+}
+
+/**
+ \brief Extract the next complete frame from the buffer
+
+ The characters of an incomplete frame remain in the buffer and the next call
+ continues the search of the frame end from the first character not yet
+ scanned.
+
+ \param frame The destination frame
+ \return true if a complete frame has been extracted, else false
+ */
+bool SerialReceiver::nextFrame(receivedFrame& frame) {
+	char c;
+	int end;
+
+	while(count > 0) {
+		c = at(0);
+
+		if(skipping != RX_SKIP_NONE) {
+			if( (skipping == RX_SKIP_BINARY) && (c == LINK_DELIMITER) ) {
+				consume(1);
+				skipping = RX_SKIP_NONE;
+			} // End of the discarded frame
+			else if( (skipping == RX_SKIP_LINE) &&
+					((c == '\r') || (c == '\n') || (c == LINK_DELIMITER)) )
+				skipping = RX_SKIP_NONE;
+			else
+				consume(1);
+			continue;
+		} // Discarding a too long frame
+
+		if( (c == '\r') || (c == '\n') ) {
+			consume(1);
+			continue;
+		} // Empty line or the second line end character
+
+		if(c == LINK_DELIMITER) {
+			if( (count > 1) && (at(1) == LINK_DELIMITER) ) {
+				consume(1);
+				continue;
+			} // Two delimiters: the first one closes a lost frame
+
+			for(end = scanned > 1 ? scanned : 1; (end < count) && (at(end) != LINK_DELIMITER); end++)
+				;
+			if(end - 1 > RX_FRAME_LEN) {
+				discarded++;
+				consume(end);
+				skipping = RX_SKIP_BINARY;
+				continue;
+			} // Frame too long
+			if(end == count) {
+				scanned = end;
+				return false;
+			} // The frame is not yet complete
+
+			frame.isBinary = true;
+			frame.length = end - 1;
+			copy(frame.data, 1, frame.length);
+			consume(end + 1);
+			return true;
+		} // Binary frame
+
+		for(end = scanned; end < count; end++) {
+			c = at(end);
+			if( (c == '\r') || (c == '\n') || (c == LINK_DELIMITER) )
+				break;
+		} // Search the line end
+		if(end > RX_FRAME_LEN) {
+			discarded++;
+			consume(end);
+			skipping = RX_SKIP_LINE;
+			continue;
+		} // Line too long
+		if(end == count) {
+			scanned = end;
+			return false;
+		} // The line is not yet complete
+		if(c == LINK_DELIMITER) {
+			discarded++;
+			consume(end);
+			continue;
+		} // Line interrupted by a binary frame
+
+		frame.isBinary = false;
+		frame.length = end;
+		copy(frame.data, 0, frame.length);
+		frame.data[frame.length] = CMD_NULLCHAR;
+		consume(end + 1);
+		return true;
+	} // Search a complete frame
+
+	return false;
+}
+
+/**
+ \brief Return the number of frames discarded since the class creation
+ */
+int SerialReceiver::getDiscarded() {
+	return discarded;
+}
+
+/**
+ \brief Discard all the received characters
+ */
+void SerialReceiver::clear() {
+	head = 0;
+	count = 0;
+	scanned = 0;
+	discarded = 0;
+	skipping = RX_SKIP_NONE;
+}
+
+/**
+ \brief Return the character at a position relative to the buffer head
+ */
+char SerialReceiver::at(int pos) {
+	return buffer[(head + pos) % RX_BUFFER_SIZE];
+}
+
+/**
+ \brief Remove characters from the buffer head
+ */
+void SerialReceiver::consume(int length) {
+	head = (head + length) % RX_BUFFER_SIZE;
+	count -= length;
+	scanned = 0;
+}
+
+/**
+ \brief Copy characters from the ring buffer to a linear buffer
+
+ \param dest The destination buffer
+ \param start The position of the first character relative to the buffer head
+ \param length The number of characters
+ */
+void SerialReceiver::copy(char* dest, int start, int length) {
+	int pos = (head + start) % RX_BUFFER_SIZE;
+	int first = RX_BUFFER_SIZE - pos;
+
+	if(first > length)
+		first = length;
+
+	memcpy(dest, buffer + pos, first);
+	memcpy(dest + first, buffer, length - first);
+}
@@ -0,0 +1,78 @@
+/**
+\file SerialReceiver.h
+\brief Reassembler of the frames received from the control panel board.
+
+ The characters read from the UART are stored in a persistent ring buffer so
+ a read can return a part of a frame or more frames together: the frames are
+ extracted only when complete and the remaining characters wait for the next
+ read. Two kinds of frames are recognised:
+
+ - ASCII lines, ended by a CR or LF character (the empty lines are ignored)
+ - binary frames enclosed between two LINK_DELIMITER bytes (see LinkProtocol.h)
+
+ As the ASCII lines never include the LINK_DELIMITER, a delimiter interrupting
+ a line discards the partial line and starts a binary frame. Lines or frames
+ longer than RX_FRAME_LEN are discarded.
+ */
+
+#include "CommandParameters.h"
+#include "LinkProtocol.h"
+
+#ifndef SERIALRECEIVER_H
+#define	SERIALRECEIVER_H
+
+//! Size of the receive ring buffer
+#define RX_BUFFER_SIZE 1024
+
+//! Max length of a received frame
+#define RX_FRAME_LEN LINK_MAX_FRAME
+
+//! Skip status: the characters are framed normally
+#define RX_SKIP_NONE	0
+//! Skip status: discarding a too long binary frame until the delimiter
+#define RX_SKIP_BINARY	1
+//! Skip status: discarding a too long line until the line end
+#define RX_SKIP_LINE	2
+
+/**
+ \brief A complete frame extracted from the receive buffer
+ */
+typedef struct SerialReceivedFrame {
+	//! The line characters, null terminated, or the COBS encoded bytes
+	//! of the binary frame without the delimiters
+	char data[RX_FRAME_LEN + 1];
+	//! Number of valid bytes in the frame
+	int length;
+	//! The frame is a binary frame
+	bool isBinary;
+} receivedFrame;
+
+class SerialReceiver {
+public:
+	SerialReceiver();
+	virtual ~SerialReceiver();
+	int receive(int fd);
+	bool nextFrame(receivedFrame& frame);
+	int getDiscarded();
+	void clear();
+private:
+	//! The received characters ring buffer
+	char buffer[RX_BUFFER_SIZE];
+	//! Position of the first character not yet extracted
+	int head;
+	//! Number of characters in the buffer
+	int count;
+	//! Number of characters already scanned without finding the frame end
+	int scanned;
+	//! Number of the frames discarded as too long or truncated
+	int discarded;
+	//! The skip status of a frame being discarded: RX_SKIP_NONE,
+	//! RX_SKIP_BINARY, RX_SKIP_LINE
+	int skipping;
+
+	char at(int pos);
+	void consume(int length);
+	void copy(char* dest, int start, int length);
+};
+
+#endif	/* SERIALRECEIVER_H */
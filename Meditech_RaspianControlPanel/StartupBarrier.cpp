@@ -0,0 +1,148 @@
+/**
+ \file StartupBarrier.cpp
+ \brief StartupBarrier class tracks the controller startup steps.
+ */
+
+#include "StartupBarrier.h"
+#include "EventLoop.h"
+#include "MessageStrings.h"
+#include <stdio.h>
+
+//! The step names shown in the report
+static const char* STEP_NAMES[STARTUP_STEPS] = {
+	"audio", "uart", "board", "lirc"
+};
+
+//! The status names shown in the report
+static const char* STATUS_NAMES[] = {
+	"idle", "running", "done", "failed"
+};
+
+/**
+ \brief Constructor method
+
+ The barrier timeout starts when the barrier is created.
+ */
+StartupBarrier::StartupBarrier() {
+	createTime = EventLoop::currentTime();
+	openTime = 0;
+	isOpened = false;
+	for(int j = 0; j < STARTUP_STEPS; j++) {
+		steps[j].status = STARTUP_IDLE;
+		steps[j].startTime = 0;
+		steps[j].endTime = 0;
+	}
+}
+
+/**
+ \brief Destructor method
+ */
+StartupBarrier::~StartupBarrier() {
+}
+
+/**
+ \brief Mark a step as started
+
+ \param step The step ID
+ */
+void StartupBarrier::begin(int step) {
+	steps[step].status = STARTUP_RUNNING;
+	steps[step].startTime = EventLoop::currentTime();
+}
+
+/**
+ \brief Mark a step as ended
+
+ The steps already ended are not changed, so a step can be completed by any
+ event signaling it.
+
+ \param step The step ID
+ \param isDone true if the step ended successfully
+ \return true if the barrier opened with this step
+ */
+bool StartupBarrier::complete(int step, bool isDone) {
+	if( (steps[step].status != STARTUP_RUNNING) || isOpened )
+		return false;
+
+	steps[step].status = isDone ? STARTUP_DONE : STARTUP_FAILED;
+	steps[step].endTime = EventLoop::currentTime();
+
+	return checkOpen();
+}
+
+/**
+ \brief Fail the steps not ended if the barrier timeout is elapsed
+
+ \return true if the barrier opened for the timeout
+ */
+bool StartupBarrier::expire() {
+	long now = EventLoop::currentTime();
+
+	if(isOpened || (now - createTime < STARTUP_TIMEOUT))
+		return false;
+
+	for(int j = 0; j < STARTUP_STEPS; j++) {
+		if(steps[j].status == STARTUP_RUNNING) {
+			steps[j].status = STARTUP_FAILED;
+			steps[j].endTime = now;
+		} // Timed out
+		else if(steps[j].status == STARTUP_IDLE) {
+			steps[j].status = STARTUP_FAILED;
+			steps[j].startTime = now;
+			steps[j].endTime = now;
+		} // Never started
+	} // Check all the steps
+
+	return checkOpen();
+}
+
+/**
+ \brief Check if all the steps are ended
+ */
+bool StartupBarrier::isOpen() {
+	return isOpened;
+}
+
+/**
+ \brief Check if all the steps ended successfully
+ */
+bool StartupBarrier::isReady() {
+	if(!isOpened)
+		return false;
+
+	for(int j = 0; j < STARTUP_STEPS; j++) {
+		if(steps[j].status != STARTUP_DONE)
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ \brief Print the status and the times of the steps
+ */
+void StartupBarrier::report() {
+	printf(STARTUP_REPORT_HEADER);
+	for(int j = 0; j < STARTUP_STEPS; j++) {
+		printf(STARTUP_REPORT_STEP, STEP_NAMES[j], STATUS_NAMES[steps[j].status],
+				steps[j].startTime, steps[j].endTime - steps[j].startTime);
+	} // Report the steps
+	printf(STARTUP_REPORT_TOTAL, openTime - createTime, openTime);
+}
+
+/**
+ \brief Open the barrier if all the steps are ended
+
+ \return true if the barrier opened
+ */
+bool StartupBarrier::checkOpen() {
+	for(int j = 0; j < STARTUP_STEPS; j++) {
+		if( (steps[j].status == STARTUP_IDLE) || (steps[j].status == STARTUP_RUNNING) )
+			return false;
+	}
+
+	isOpened = true;
+	openTime = EventLoop::currentTime();
+
+	return true;
+}
@@ -0,0 +1,77 @@
+/**
+\file StartupBarrier.h
+\brief Readiness barrier of the controller startup steps.
+
+ The startup steps run concurrently: the audio worker establishes the ssh
+ connection in its own process, the board answers the link handshake through
+ the event loop while lirc is initialized. Every step is marked as started
+ and as ended (done or failed) and the barrier opens when all the steps are
+ ended or STARTUP_TIMEOUT is elapsed.
+
+ The step times are taken from the monotonic clock, that on Linux counts from
+ the boot, so the report shows both the step durations and the time from the
+ boot to the controller readiness.
+ */
+
+#ifndef STARTUPBARRIER_H
+#define	STARTUPBARRIER_H
+
+//! Step: the audio worker and its ssh connection
+#define STARTUP_STEP_AUDIO	0
+//! Step: the UART opening and configuration
+#define STARTUP_STEP_UART	1
+//! Step: the board answer to the link handshake
+#define STARTUP_STEP_BOARD	2
+//! Step: the lirc initialization and configuration
+#define STARTUP_STEP_LIRC	3
+//! Number of startup steps
+#define STARTUP_STEPS		4
+
+//! Step status: not started
+#define STARTUP_IDLE		0
+//! Step status: started and not yet ended
+#define STARTUP_RUNNING		1
+//! Step status: ended successfully
+#define STARTUP_DONE		2
+//! Step status: ended with an error or timed out
+#define STARTUP_FAILED		3
+
+//! Max time from the barrier creation to the end of all the steps (ms)
+#define STARTUP_TIMEOUT 5000
+
+/**
+ \brief The status and the times of a startup step
+ */
+typedef struct StartupStep {
+	//! The step status
+	int status;
+	//! The step start time (ms from the boot)
+	long startTime;
+	//! The step end time (ms from the boot)
+	long endTime;
+} startupStep;
+
+class StartupBarrier {
+public:
+	StartupBarrier();
+	virtual ~StartupBarrier();
+	void begin(int step);
+	bool complete(int step, bool isDone);
+	bool expire();
+	bool isOpen();
+	bool isReady();
+	void report();
+private:
+	//! The steps
+	startupStep steps[STARTUP_STEPS];
+	//! The barrier creation time (ms from the boot)
+	long createTime;
+	//! The time the barrier opened (ms from the boot)
+	long openTime;
+	//! The barrier is open
+	bool isOpened;
+
+	bool checkOpen();
+};
+
+#endif	/* STARTUPBARRIER_H */
@@ -0,0 +1,238 @@
+/**
+ \file TTSGenerator.cpp
+ \brief TTSGenerator class converts the message strings to voice messages.
+ */
+
+#include "TTSGenerator.h"
+#include "AudioDispatcher.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ \brief Constructor method
+
+ \param strings The message strings array, in message ID order. The array
+ should remain valid for the class instance life
+ \param numStrings The number of message strings, up to TTS_MAX_MESSAGES
+ */
+TTSGenerator::TTSGenerator(const char* const* strings, int numStrings) {
+	messages = strings;
+	numMessages = numStrings < TTS_MAX_MESSAGES ? numStrings : TTS_MAX_MESSAGES;
+	converted = 0;
+	for(int j = 0; j < TTS_MAX_MESSAGES; j++) {
+		hashes[j] = TTS_NO_HASH;
+		jobs[j] = -1;
+	}
+}
+
+/**
+ \brief Destructor method
+ */
+TTSGenerator::~TTSGenerator() {
+}
+
+/**
+ \brief Convert the changed messages and update the manifest
+
+ Up to one conversion per core runs at the same time. The function returns
+ when all the conversions are ended.
+
+ \return The number of failed conversions
+ */
+int TTSGenerator::generate() {
+	long poolSize = sysconf(_SC_NPROCESSORS_ONLN);
+	int next = 0;
+	int running = 0;
+	int failed = 0;
+	int status;
+	pid_t pid;
+
+	if(poolSize < 1)
+		poolSize = 1;
+
+	loadManifest();
+	converted = 0;
+
+	while( (next < numMessages) || (running > 0) ) {
+		while( (next < numMessages) && (running < poolSize) ) {
+			if(isChanged(next)) {
+				jobs[next] = startJob(next);
+				if(jobs[next] == -1) {
+					fprintf(stderr, TTS_JOB_FAILED, next + 1);
+					failed++;
+				} // Can't start the conversion
+				else
+					running++;
+			} // Convert the message
+			next++;
+		} // Fill the pool
+
+		if(running == 0)
+			break;
+
+		pid = waitpid(-1, &status, 0);
+		if(pid == -1)
+			break;	// No more children
+
+		int j = findJob(pid);
+		if(j == -1)
+			continue;	// Not a conversion process
+
+		jobs[j] = -1;
+		running--;
+		if(WIFEXITED(status) && (WEXITSTATUS(status) == 0)) {
+			hashes[j] = hash(messages[j]);
+			converted++;
+		} // Conversion completed
+		else {
+			hashes[j] = TTS_NO_HASH;
+			fprintf(stderr, TTS_JOB_FAILED, j + 1);
+			failed++;
+		} // Conversion failed
+	} // Run the pool
+
+	if(!saveManifest())
+		fprintf(stderr, TTS_MANIFEST_ERROR);
+
+	return failed;
+}
+
+/**
+ \brief Return the number of messages converted by the last generation
+ */
+int TTSGenerator::getConverted() {
+	return converted;
+}
+
+/**
+ \brief Read the string hashes of the converted messages
+
+ The manifest has a line for every converted message in the format
+ <message number> <hash>. A missing or damaged manifest converts all the
+ messages.
+ */
+void TTSGenerator::loadManifest() {
+	FILE* manifest = fopen(TTS_FOLDER TTS_MANIFEST, "r");
+	unsigned long value;
+	int number;
+
+	if(manifest == NULL)
+		return;
+
+	while(fscanf(manifest, "%d %lx", &number, &value) == 2) {
+		if( (number > 0) && (number <= numMessages) )
+			hashes[number - 1] = (uint32_t)value;
+	} // Read the lines
+
+	fclose(manifest);
+}
+
+/**
+ \brief Write the string hashes of the converted messages
+
+ The manifest is written to a temporary file then renamed, so an interrupted
+ generation does not leave a damaged manifest.
+
+ \return false if the manifest can't be written
+ */
+bool TTSGenerator::saveManifest() {
+	FILE* manifest = fopen(TTS_FOLDER TTS_MANIFEST ".tmp", "w");
+	bool isWritten;
+
+	if(manifest == NULL)
+		return false;
+
+	for(int j = 0; j < numMessages; j++) {
+		if(hashes[j] != TTS_NO_HASH)
+			fprintf(manifest, "%d %08lx\n", j + 1, (unsigned long)hashes[j]);
+	} // Write the converted messages
+
+	isWritten = fclose(manifest) == 0;
+	if(isWritten)
+		isWritten = rename(TTS_FOLDER TTS_MANIFEST ".tmp", TTS_FOLDER TTS_MANIFEST) == 0;
+
+	return isWritten;
+}
+
+/**
+ \brief Check if a message should be converted
+
+ \param messageID The message ID
+ \return true if the string changed since the last conversion or the audio
+ file is missing
+ */
+bool TTSGenerator::isChanged(int messageID) {
+	char fileName[64];
+	struct stat fileStatus;
+
+	if(hashes[messageID] != hash(messages[messageID]))
+		return true;
+
+	sprintf(fileName, "%s%d.%s", TTS_FOLDER, messageID + 1, TTS_FORMAT);
+	return stat(fileName, &fileStatus) != 0;
+}
+
+/**
+ \brief Launch the conversion script of a message
+
+ \param messageID The message ID
+ \return The conversion process id or -1 on error
+ */
+pid_t TTSGenerator::startJob(int messageID) {
+	char fileName[64];
+	char fileTemp[64];
+	pid_t pid;
+
+	sprintf(fileName, "%s%d.%s", TTS_FOLDER, messageID + 1, TTS_FORMAT);
+	sprintf(fileTemp, "%d.tmp", messageID + 1);
+
+	char* arg_list[] = {
+		(char*)TTS_SHELL_COMMAND,
+		(char*)messages[messageID],
+		fileName,
+		fileTemp,
+		NULL
+	};
+
+	pid = fork();
+	if(pid == 0) {
+		AudioDispatcher::unblockSignals();
+		execvp(TTS_SHELL_PATH, arg_list);
+		fprintf(stderr, TTS_SPAWN_ERROR);
+		_exit(EXIT_FAILURE);
+	} // Conversion process
+
+	return pid;
+}
+
+/**
+ \brief Return the message ID converted by a process or -1
+ */
+int TTSGenerator::findJob(pid_t pid) {
+	for(int j = 0; j < numMessages; j++) {
+		if(jobs[j] == pid)
+			return j;
+	}
+
+	return -1;
+}
+
+/**
+ \brief Calculate the FNV-1a hash of a message string
+
+ \param text The message string
+ \return The hash value, never TTS_NO_HASH
+ */
+uint32_t TTSGenerator::hash(const char* text) {
+	uint32_t h = TTS_HASH_SEED;
+
+	while(*text != '\0') {
+		h ^= (uint8_t)*text++;
+		h *= TTS_HASH_PRIME;
+	}
+
+	return h == TTS_NO_HASH ? 1 : h;
+}
@@ -0,0 +1,59 @@
+/**
+\file TTSGenerator.h
+\brief Incremental generation of the voice message files.
+
+ Every message string is converted to an audio file in TTS_FOLDER by the
+ TTS_SHELL_COMMAND script (festival). The conversion is slow, so only the
+ messages changed since the last run are converted: the hash of every converted
+ string is saved in the TTS_MANIFEST file and a message is converted again only
+ if its string hash differs or the audio file is missing.
+
+ The conversions run in parallel in a pool of processes sized to the number
+ of cores. The generator waits for every conversion and counts the failed ones;
+ a failed message is not recorded in the manifest, so it is converted again on
+ the next run.
+ */
+
+#include "MessageStrings.h"
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifndef TTSGENERATOR_H
+#define	TTSGENERATOR_H
+
+//! FNV-1a 32 bits offset basis
+#define TTS_HASH_SEED 2166136261UL
+
+//! FNV-1a 32 bits prime
+#define TTS_HASH_PRIME 16777619UL
+
+//! Manifest hash of the messages never converted
+#define TTS_NO_HASH 0
+
+class TTSGenerator {
+public:
+	TTSGenerator(const char* const* strings, int numStrings);
+	virtual ~TTSGenerator();
+	int generate();
+	int getConverted();
+private:
+	//! The message strings
+	const char* const* messages;
+	//! Number of message strings
+	int numMessages;
+	//! The string hashes of the converted messages
+	uint32_t hashes[TTS_MAX_MESSAGES];
+	//! The process id converting each message or -1
+	pid_t jobs[TTS_MAX_MESSAGES];
+	//! Number of messages converted by the last generation
+	int converted;
+
+	void loadManifest();
+	bool saveManifest();
+	bool isChanged(int messageID);
+	pid_t startJob(int messageID);
+	int findJob(pid_t pid);
+	static uint32_t hash(const char* text);
+};
+
+#endif	/* TTSGENERATOR_H */
@@ -15,24 +15,28 @@
  of the user with the system, resulting in a semi-automated architecture and a high
  usability level.
  
- The application is essentially built over a main while() loop controlling the IR controller
- button press. When the lirc interface has been opened correctly without errors, also
- the serial interface (connecting the control panel board) is opened for the remote communication
+ The application is built over a single epoll event loop (see the EventLoop class).
+ When the lirc interface has been opened correctly without errors, also the serial
+ interface (connecting the control panel board) is opened for the remote communication.
  Both the communication lines (serial and IR) are set to run in non-blocking mode to avoid
  system hangs and too long delays.
- The serial interface remain opened granting the communication with the control panel board
- but the commands are originated from the master. In the meantime, the UART connection is checked
- every IR cycle to see is there are characters waiting to be received in the queue, further sent
- to the parser. This grant that the master device is able to answer to calls from
+ The lirc socket, the UART and a periodic timer are watched together by the loop, so
+ every source is dispatched as soon as it is ready: the IR codes are parsed when a key
+ is pressed, the characters received from the control panel board are read as soon
+ as they arrive (also when no key is pressed) and the periodic work runs on the timer
+ without busy polling. This grant that the master device is able to answer to calls from
  the control panel board, i.e. alarm or specific parameters requests.
  
  The architecture can work without changes also when more conditions should be managed
  in one of the two directions, simply including more accepted command requests in the
  parser or adding display templates for sending to the control panel board.
  
- \note When a command is recognized as a valid button it is not possible to send more commands
- (no queueing is supported). As a matter of fact the entire multi-computer Meditech is a
- parallel state machine that should work in a completely asynchronous way.
+ \note The commands generated by the recognized buttons are queued (see the SerialQueue class)
+ so fast key sequences are sent in order without waiting for every round trip. Every command
+ is tagged with a sequence ID and up to IN_FLIGHT_WINDOW commands can wait for the response
+ at the same time (see the RequestTracker class). As a matter
+ of fact the entire multi-computer Meditech is a parallel state machine that should work in
+ a completely asynchronous way.
  
  The program is started on boot but can be launched from the command line with the parameter
  VOICE_STRINGS In this case instead of starting the controller loop the program generate the
@@ -58,7 +62,23 @@
 #include "ControllerKeys.h"
 #include "LCDTemplatesMaster.h"
 #include "CommandProcessor.h"
+#include "ParserErrors.h"
+#include "DisplayScheduler.h"
 #include "MessageStrings.h"
+#include "EventLoop.h"
+#include "SerialQueue.h"
+#include "RequestTracker.h"
+#include "SerialReceiver.h"
+#include "IRKeyMap.h"
+#include "AudioDispatcher.h"
+#include "TTSGenerator.h"
+#include "AssetPack.h"
+#include "AudioCodec.h"
+#include "StartupBarrier.h"
+#include <math.h>
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
 
 #undef __DEBUG
 
@@ -68,8 +88,44 @@ int uart0_filestream = -1;
 //! Status flags structure
 states controllerStatus;
 
-//! The command string to be sent to the control panel
-char* cmdString = '\0';
+//! CommandProcessor class instance holding the template commands
+CommandProcessor cProc;
+
+//! The rate limiter of the template field updates
+DisplayScheduler displayScheduler(cProc);
+
+//! The commands tagged with the sequence ID, being written to the UART
+SerialQueue serialQueue;
+
+//! The commands waiting for a free slot in the in-flight window
+SerialQueue pendingQueue;
+
+//! The commands sent to the control panel and waiting for the response
+RequestTracker requestTracker;
+
+//! The characters received from the control panel, split in frames
+SerialReceiver serialReceiver;
+
+//! The event loop dispatching the IR, serial and timer events
+EventLoop eventLoop;
+
+//! Array with all the controller IR keys string name
+//! If a string in the array match with the lirc return code the corresponding array index
+//! is used to execute the associated command.
+const char *IR_KEYS[NUM_KEYS] = { KEY_MENU, KEY_POWER, KEY_NUMERIC_0, KEY_NUMERIC_1, KEY_NUMERIC_2,
+			KEY_NUMERIC_3, KEY_NUMERIC_4, KEY_NUMERIC_5, KEY_NUMERIC_6,
+			KEY_NUMERIC_7, KEY_NUMERIC_8, KEY_NUMERIC_9, KEY_UP, KEY_DOWN,
+			KEY_LEFT, KEY_RIGHT, KEY_RED, KEY_GREEN, KEY_YELLOW, KEY_BLUE,
+			KEY_OK, KEY_MUTE, KEY_VOLUMEUP, KEY_VOLUMEDOWN, KEY_CHANNELUP, KEY_CHANNELDOWN };
+
+//! Hash table identifying the IR_KEYS index of the lirc codes
+IRKeyMap irKeyMap(IR_KEYS, NUM_KEYS);
+
+//! The voice messages worker process
+AudioDispatcher audioDispatcher;
+
+//! The startup steps readiness barrier, created when the program starts
+StartupBarrier startupBarrier;
 
 /**
  \brief main The main entry point of the program
@@ -87,10 +143,12 @@ char* cmdString = '\0';
 int main(int argc, char *argv[]) {
 	//! The lirc client configuration
 	struct lirc_config *config;
-	//! The last read code from the IR controller
-	char *code;
-	//! A character pointer. What else?
-	char *s;
+	//! The lirc socket file descriptor
+	int lircSocket;
+	//! The signals received through the signalfd
+	sigset_t childSignals;
+	//! The SIGCHLD signalfd
+	int childSignalFd;
 	
 	// Check for main parameters
 	if(argc > 1) {
@@ -103,10 +161,15 @@ int main(int argc, char *argv[]) {
 		// We expect an argument in the format '-x' where 'x' is
 		// the option code
 		if(strstr(argv[1], VOICE_STRINGS) ) {
-			ttsStrings();
+			if(ttsStrings() > 0)
+				exit(EXIT_FAILURE);	// Some messages not converted
 			printf(MAINEXIT_DONE);
 			exit(0);	// ending
 		} // Launch the TTS generation
+		else if(strstr(argv[1], BENCH_AUDIO) ) {
+			audioBench();
+			exit(0);	// ending
+		} // Measure the voice messages encoding
 		else {
 			printf(MAINEXIT_WRONGPARAM);
 			exit(EXIT_FAILURE); // Wrong argument
@@ -115,86 +178,341 @@ int main(int argc, char *argv[]) {
 	
 	initFlags();
 
-//! Array with all the controller IR keys string name
-//! If a string in the array match with the lirc return code the corresponding array index
-//! is used to execute the associated command.
-	const char *IR_KEYS[NUM_KEYS] = { KEY_MENU, KEY_POWER, KEY_NUMERIC_0, KEY_NUMERIC_1, KEY_NUMERIC_2,
-				KEY_NUMERIC_3, KEY_NUMERIC_4, KEY_NUMERIC_5, KEY_NUMERIC_6,
-				KEY_NUMERIC_7, KEY_NUMERIC_8, KEY_NUMERIC_9, KEY_UP, KEY_DOWN,
-				KEY_LEFT, KEY_RIGHT, KEY_RED, KEY_GREEN, KEY_YELLOW, KEY_BLUE,
-				KEY_OK, KEY_MUTE, KEY_VOLUMEUP, KEY_VOLUMEDOWN, KEY_CHANNELUP, KEY_CHANNELDOWN };
+	// The ended child processes are notified to the event loop through a signalfd
+	sigemptyset(&childSignals);
+	sigaddset(&childSignals, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &childSignals, NULL);
+	// A write to the pipe of an ended audio worker should fail with EPIPE
+	// instead of ending the controller
+	signal(SIGPIPE, SIG_IGN);
+
+	// The startup steps run concurrently: the audio worker connects to the
+	// remote player in its own process and the board answers the link
+	// handshake while lirc is initialized. The barrier opens when all the
+	// steps are ended (see completeStartupStep())
+
+	// Start the voice messages worker before opening the devices, so the
+	// worker does not inherit them
+	startupBarrier.begin(STARTUP_STEP_AUDIO);
+	if(!audioDispatcher.start()) {
+		fprintf(stderr, AUDIO_WORKER_ERROR);
+		completeStartupStep(STARTUP_STEP_AUDIO, false);
+	} // No voice messages
+
+	if(!eventLoop.open())
+		exit(EXIT_FAILURE);
+
+	// Initialise the serial connection
+	startupBarrier.begin(STARTUP_STEP_UART);
+	uart0_filestream = open(UART_DEVICE, O_RDWR | O_NOCTTY | O_NDELAY | O_CLOEXEC);
+	// Check the UART opening status. If a problem occur, the application exits.
+	if(uart0_filestream == -1)
+		exit(EXIT_FAILURE);
+
+	// Configure the UART connection
+	struct termios options;
+	tcgetattr(uart0_filestream, &options);
+	options.c_cflag = B38400 | CS8 | CLOCAL | CREAD;
+	options.c_iflag = IGNPAR;
+	options.c_oflag = 0;
+	options.c_lflag = 0;
+	// Serial buffer is flushed before setting the parameters correctly
+	tcflush(uart0_filestream, TCIFLUSH);
+	tcsetattr(uart0_filestream, TCSANOW, &options);		
+	// Set the UART flag status
+	controllerStatus.isUARTRunning = true;
+	if(!eventLoop.addWatch(uart0_filestream, EPOLLIN, serialEvent, NULL))
+		exit(EXIT_FAILURE);
+	completeStartupStep(STARTUP_STEP_UART, true);
+
+	// Send the link handshake before initializing lirc, so the board answers
+	// in the meantime. If the binary protocol is used the board is asked to
+	// switch to it: until the board acknowledges the request the commands are
+	// sent as ASCII strings.
+	startupBarrier.begin(STARTUP_STEP_BOARD);
+	if(LINK_USE_BINARY)
+		controllerStatus.linkMode = LINK_MODE_NEGOTIATING;
+	queueCommand(cProc.buildLinkModeCommand(LINK_USE_BINARY));
 
 	//Initiate LIRC. Exit on failure
-	if(lirc_init((char *)LIRC_CLIENT, 1) == -1)
+	startupBarrier.begin(STARTUP_STEP_LIRC);
+	lircSocket = lirc_init((char *)LIRC_CLIENT, 1);
+	if(lircSocket == -1)
 			exit(EXIT_FAILURE);
  
 	//Read the default LIRC config at /etc/lirc/lircd.conf
-	if(lirc_readconfig(NULL, &config, NULL) == 0) {
-		// Set the lirc status flag
-		controllerStatus.isLircRunning = true;
-		// As lirc is working intialise the serial connection
-		uart0_filestream = open(UART_DEVICE, O_RDWR | O_NOCTTY | O_NDELAY);
-		// Check the UART opening status. If a problem occur, the application exits.
-		if(uart0_filestream == -1) {
-			//Frees the data structures associated with config.
-			lirc_freeconfig(config);
-			// Closes the connection to lircd and does some internal clean-up stuff.
-			lirc_deinit();
-			// Set the lirc status flag
-			controllerStatus.isLircRunning = false;
-			exit(EXIT_FAILURE); // The /etc/lirc/lircd,conf file does not exist.
-		} // Problem opening the UART. Exit with error
-		
-		// Configure the UART connection
-		struct termios options;
-		tcgetattr(uart0_filestream, &options);
-		options.c_cflag = B38400 | CS8 | CLOCAL | CREAD;
-		options.c_iflag = IGNPAR;
-		options.c_oflag = 0;
-		options.c_lflag = 0;
-		// Serial buffer is flushed before setting the parameters correctly
-		tcflush(uart0_filestream, TCIFLUSH);
-		tcsetattr(uart0_filestream, TCSANOW, &options);		
-		// Set the UART flag status
-		controllerStatus.isUARTRunning = true;
-		// Mount remotely the audio meesages folder
-		remoteMount_Umount(true);
-
-		// ====================================================================
-		// This is virtually our infinite loop. The only exit condition
-		// is when the socket is closed.
-		// ====================================================================
-		while(lirc_nextcode(&code) == 0) {
-			// Check the serial status
-			manageSerial();
-			
-			// If code = NULL, meaning nothing was returned from LIRC socket,
-			// then skip lines below and start while loop again.
-			if(code == NULL) continue;
-			
-			// Loop on the IR keys array key names searching if a valid
-			// key has been pressed.
-			for(int i = 0; i < NUM_KEYS; i++) {
-				// Search for a corresponding key
-				if(strstr(code, IR_KEYS[i])){
-					// Parse the key event
-					parseIR(i);
-					break; // Forces the loop exit.
-				} // found the pressed key
-			} // Loop searching the key press.
-		} // IR code processing
-		// ====================================================================
-		// Lirc controller infinite loop / END
-		// ====================================================================
-		// Need to free up code before the next loop
-		free(code);
-	} // infinite reading loop
+	if(lirc_readconfig(NULL, &config, NULL) != 0) {
+		// Closes the connection to lircd and does some internal clean-up stuff.
+		lirc_deinit();
+		exit(EXIT_FAILURE); // The /etc/lirc/lircd,conf file does not exist.
+	} // Problem reading the lirc configuration. Exit with error
+
+	// Set the lirc status flag
+	controllerStatus.isLircRunning = true;
+	// The lirc socket should not block the loop when no codes are waiting
+	fcntl(lircSocket, F_SETFL, fcntl(lircSocket, F_GETFL) | O_NONBLOCK);
+	// A restarted audio worker and its players should not hold the socket
+	fcntl(lircSocket, F_SETFD, FD_CLOEXEC);
+	completeStartupStep(STARTUP_STEP_LIRC, true);
+
+	// ====================================================================
+	// This is virtually our infinite loop. The only exit condition
+	// is when the lirc socket is closed.
+	// ====================================================================
+	childSignalFd = signalfd(-1, &childSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+	if( (audioDispatcher.getStatusFd() != -1) &&
+			!eventLoop.addWatch(audioDispatcher.getStatusFd(), EPOLLIN, audioEvent, NULL) )
+		completeStartupStep(STARTUP_STEP_AUDIO, false);
+	if(eventLoop.addWatch(lircSocket, EPOLLIN, irEvent, NULL) &&
+			eventLoop.addWatch(childSignalFd, EPOLLIN, childEvent, NULL) &&
+			(eventLoop.addTimer(CONTROLLER_TIMER_PERIOD, timerEvent, NULL) != -1) &&
+			(eventLoop.addTimer(DISPLAY_FLUSH_PERIOD, displayEvent, NULL) != -1) ) {
+		eventLoop.run();
+	} // Event loop running
+	// ====================================================================
+	// Event loop / END
+	// ====================================================================
+
 	//Frees the data structures associated with config.
 	lirc_freeconfig(config);
 	// Closes the connection to lircd and does some internal clean-up stuff.
 	lirc_deinit();
-	remoteMount_Umount(false);
-	exit(EXIT_FAILURE); // The /etc/lirc/lircd,conf file does not exist.
+	exit(EXIT_FAILURE); // The lirc socket has been closed
+}
+
+/**
+ \brief Event loop callback for the lirc socket.
+ 
+ All the IR codes waiting on the socket are read and parsed. When the lirc
+ socket is closed the event loop is stopped and the program ends.
+ 
+ \param fd The lirc socket
+ \param events The ready events mask
+ \param context Unused
+ */
+void irEvent(int fd, uint32_t events, void* context) {
+	//! The last read code from the IR controller
+	char *code;
+	//! The key ID of the code
+	int key;
+
+	while(lirc_nextcode(&code) == 0) {
+		// If code = NULL, meaning nothing more was returned from LIRC socket,
+		// then wait for the next event.
+		if(code == NULL)
+			return;
+		
+		// Search the key name of the code in the keys hash table
+		key = irKeyMap.find(code);
+		if(key != IR_KEY_NONE)
+			parseIR(key);
+		
+		// Need to free up code before the next read
+		free(code);
+	} // IR code processing
+	
+	// The lirc socket has been closed
+	eventLoop.stop();
+}
+
+/**
+ \brief Event loop callback for the UART.
+ 
+ When the UART is writable the queued commands not yet sent are written. The
+ responses are read as soon as they arrive, also while other commands are
+ still being sent.
+ 
+ \param fd The UART file descriptor
+ \param events The ready events mask
+ \param context Unused
+ */
+void serialEvent(int fd, uint32_t events, void* context) {
+	if( (events & EPOLLOUT) && (controllerStatus.serialState == SERIAL_READY_TO_SEND) )
+		manageSerial();
+
+	if(events & EPOLLIN)
+		readSerial();
+}
+
+/**
+ \brief Event loop callback for the periodic controller timer.
+ 
+ Runs the periodic work of the controller, i.e. releases the commands with
+ no response in time and sends the commands still waiting in the serial status.
+ 
+ \param fd The timer file descriptor
+ \param events The ready events mask
+ \param context Unused
+ */
+void timerEvent(int fd, uint32_t events, void* context) {
+	if(startupBarrier.expire())
+		startupReady();
+
+	if(requestTracker.expire() > 0) {
+		fprintf(stderr, SERIAL_RESPONSE_TIMEOUT);
+		// The board may have been reset: its display state is no more known
+		cProc.invalidateMirror();
+		fillWindow();
+	} // Slots released
+
+	manageSerial();
+}
+
+/**
+ \brief Event loop callback for the display update timer.
+ 
+ The master clock fields are updated, then the template fields changed since
+ the last flush are sent to the board. While the previous commands are still
+ waiting to be sent or acknowledged the flush is delayed, so the field updates
+ are coalesced, the serial link is not saturated and the fields are compared
+ with the state acknowledged by the board.
+ 
+ \param fd The timer file descriptor
+ \param events The ready events mask
+ \param context Unused
+ */
+void displayEvent(int fd, uint32_t events, void* context) {
+	updateClock();
+
+	if(pendingQueue.isEmpty() && requestTracker.isEmpty())
+		displayScheduler.flush(queueCommand);
+}
+
+/**
+ \brief Update the date and time fields of the info template.
+ 
+ The fields are changed once a minute and sent to the board by the display
+ scheduler only while the info template is shown. A string longer than the
+ board field is not sent.
+ */
+void updateClock(void) {
+	char date[INFO_DATE_LEN + 1];
+	char clock[INFO_TIME_LEN + 1];
+	time_t now = time(NULL);
+	struct tm local;
+
+	if(localtime_r(&now, &local) == NULL)
+		return;
+
+	if(strftime(date, sizeof(date), INFO_DATE_FORMAT, &local) > 0)
+		displayScheduler.update(TID_INFO, INFO_DATE_FIELD, date);
+	if(strftime(clock, sizeof(clock), INFO_TIME_FORMAT, &local) > 0)
+		displayScheduler.update(TID_INFO, INFO_TIME_FIELD, clock);
+}
+
+/**
+ \brief Event loop callback for the SIGCHLD signalfd.
+ 
+ All the ended child processes are reaped. If the voice messages worker
+ has ended it is started again (see AudioDispatcher::getRestartDelay()).
+ 
+ \param fd The signalfd
+ \param events The ready events mask
+ \param context Unused
+ */
+void childEvent(int fd, uint32_t events, void* context) {
+	struct signalfd_siginfo info;
+	pid_t pid;
+
+	while(read(fd, &info, sizeof(info)) == sizeof(info))
+		;
+
+	while( (pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+		if(pid == audioDispatcher.getPid())
+			scheduleAudioRestart();
+	} // Reap the ended processes
+}
+
+/**
+ \brief Restart the ended voice messages worker, after the restart delay
+ 
+ The status pipe of the ended worker is no more watched. If the worker ended
+ too many times it is not restarted and the voice messages are not played.
+ */
+void scheduleAudioRestart(void) {
+	int delay;
+
+	if(audioDispatcher.getStatusFd() != -1)
+		eventLoop.removeWatch(audioDispatcher.getStatusFd());
+	audioDispatcher.stop();
+
+	delay = audioDispatcher.getRestartDelay();
+	if(delay == -1)
+		fprintf(stderr, AUDIO_WORKER_GIVEUP);
+	else if(delay == 0)
+		restartAudioWorker();
+	else if(eventLoop.addTimer(delay, audioRestartEvent, NULL) == -1)
+		fprintf(stderr, AUDIO_WORKER_ERROR);
+}
+
+/**
+ \brief Event loop callback for the audio worker restart delay.
+ 
+ The timer is used once: it is removed and the worker is started.
+ 
+ \param fd The timer file descriptor
+ \param events The ready events mask
+ \param context Unused
+ */
+void audioRestartEvent(int fd, uint32_t events, void* context) {
+	eventLoop.removeTimer(fd);
+	restartAudioWorker();
+}
+
+/**
+ \brief Start the voice messages worker again and watch its status pipe
+ */
+void restartAudioWorker(void) {
+	if(!audioDispatcher.start()) {
+		fprintf(stderr, AUDIO_WORKER_ERROR);
+		return;
+	} // No voice messages
+
+	if(!eventLoop.addWatch(audioDispatcher.getStatusFd(), EPOLLIN, audioEvent, NULL))
+		fprintf(stderr, AUDIO_WORKER_ERROR);
+}
+
+/**
+ \brief Event loop callback for the audio worker status pipe.
+ 
+ The worker sends a single status byte when the voice messages can be played
+ (or can't be played), then closes the pipe.
+ \param fd The status pipe
+ \param events The ready events mask
+ \param context Unused
+ */
+void audioEvent(int fd, uint32_t events, void* context) {
+	char status;
+
+	if(read(fd, &status, 1) == 1)
+		completeStartupStep(STARTUP_STEP_AUDIO, status == AUDIO_STATUS_READY);
+	else
+		completeStartupStep(STARTUP_STEP_AUDIO, false);
+
+	eventLoop.removeWatch(fd);
+}
+
+/**
+ \brief Mark a startup step as ended and check the readiness barrier
+ 
+ \param step The startup step ID
+ \param isDone true if the step ended successfully
+ */
+void completeStartupStep(int step, bool isDone) {
+	if(startupBarrier.complete(step, isDone))
+		startupReady();
+}
+
+/**
+ \brief Report the startup when the readiness barrier opens
+ 
+ The startup steps timing is printed and, if all the steps ended successfully,
+ the system ready voice message is played.
+ */
+void startupReady(void) {
+	startupBarrier.report();
+	if(startupBarrier.isReady())
+		playRemoteMessage(TTS_SYSTEM_READY);
 }
 
 /**
@@ -213,8 +531,6 @@ int main(int argc, char *argv[]) {
  \param infraredID The IR command ID
  */
 void parseIR(int infraredID) {
-	//! CommandProcessor class instance.
-	CommandProcessor cProc;
 	bool remoteSSH_Success;
 	
 	// Process the ID
@@ -224,7 +540,8 @@ void parseIR(int infraredID) {
 				if(!controllerStatus.isMuted) {
 					playRemoteMessage(TTS_SYSTEM_RESTARTED);
 				}
-				cmdString = cProc.buildCommandDisplayTemplate(TID_DEFAULT);
+				selectProbe(PROBE_ACTIVE_NONE);
+				queueCommand(cProc.buildCommandDisplayTemplate(TID_DEFAULT));
 				setPowerOffStatus(POWEROFF_NONE);
 			}
 			break;
@@ -244,11 +561,9 @@ void parseIR(int infraredID) {
 				if(!controllerStatus.isMuted) {
 					playRemoteMessage(TTS_STETHOSCOPE_ON);
 				}
-				cmdString = cProc.buildCommandDisplayTemplate(TID_STETHOSCOPE);
-				controllerStatus.serialState = SERIAL_READY_TO_SEND;
+				selectProbe(PROBE_ACTIVE_STETHOSCOPE);
+				queueCommand(cProc.buildCommandDisplayTemplate(TID_STETHOSCOPE));
 				setPowerOffStatus(POWEROFF_NONE);
-				// Check the serial status
-				manageSerial();
 			}
 			break;
 		case CMD_NUMERIC_2:
@@ -256,11 +571,9 @@ void parseIR(int infraredID) {
 				if(!controllerStatus.isMuted) {
 					playRemoteMessage(TTS_BLOOD_PRESSURE_ON);
 				}
-				cmdString = cProc.buildCommandDisplayTemplate(TID_BLOODPRESS);
-				controllerStatus.serialState = SERIAL_READY_TO_SEND;
+				selectProbe(PROBE_ACTIVE_PRESSURE);
+				queueCommand(cProc.buildCommandDisplayTemplate(TID_BLOODPRESS));
 				setPowerOffStatus(POWEROFF_NONE);
-				// Check the serial status
-				manageSerial();
 			}
 			break;
 		case CMD_NUMERIC_3:
@@ -268,11 +581,9 @@ void parseIR(int infraredID) {
 				if(!controllerStatus.isMuted) {
 					playRemoteMessage(TTS_HEATBEAT_ON);
 				}
-				cmdString = cProc.buildCommandDisplayTemplate(TID_HEARTBEAT);
-				controllerStatus.serialState = SERIAL_READY_TO_SEND;
+				selectProbe(PROBE_ACTIVE_HEARTBEAT);
+				queueCommand(cProc.buildCommandDisplayTemplate(TID_HEARTBEAT));
 				setPowerOffStatus(POWEROFF_NONE);
-				// Check the serial status
-				manageSerial();
 			}
 			break;
 		case CMD_NUMERIC_4:
@@ -280,11 +591,9 @@ void parseIR(int infraredID) {
 				if(!controllerStatus.isMuted) {
 					playRemoteMessage(TTS_TEMPERATURE_ON);
 				}
-				cmdString = cProc.buildCommandDisplayTemplate(TID_TEMPERATURE);
-				controllerStatus.serialState = SERIAL_READY_TO_SEND;
+				selectProbe(PROBE_ACTIVE_TEMPERATURE);
+				queueCommand(cProc.buildCommandDisplayTemplate(TID_TEMPERATURE));
 				setPowerOffStatus(POWEROFF_NONE);
-				// Check the serial status
-				manageSerial();
 			}
 			break;
 		case CMD_NUMERIC_5:
@@ -292,11 +601,9 @@ void parseIR(int infraredID) {
 				if(!controllerStatus.isMuted) {
 					playRemoteMessage(TTS_ECG_ON);
 				}
-				cmdString = cProc.buildCommandDisplayTemplate(TID_ECG);
-				controllerStatus.serialState = SERIAL_READY_TO_SEND;
+				selectProbe(PROBE_ACTIVE_ECG);
+				queueCommand(cProc.buildCommandDisplayTemplate(TID_ECG));
 				setPowerOffStatus(POWEROFF_NONE);
-				// Check the serial status
-				manageSerial();
 			}
 			break;
 		case CMD_NUMERIC_6:
@@ -328,11 +635,8 @@ void parseIR(int infraredID) {
 				if(!controllerStatus.isMuted) {
 					playRemoteMessage(TTS_TESTING);
 				}
-				cmdString = cProc.buildCommandDisplayTemplate(TID_TEST);
-				controllerStatus.serialState = SERIAL_READY_TO_SEND;
+				queueCommand(cProc.buildCommandDisplayTemplate(TID_TEST));
 				setPowerOffStatus(POWEROFF_NONE);
-				// Check the serial status
-				manageSerial();
 			}
 			break;
 		case CMD_GREEN:
@@ -340,11 +644,8 @@ void parseIR(int infraredID) {
 				if(!controllerStatus.isMuted) {
 					playRemoteMessage(TTS_SYSTEM_READY);
 				}
-				cmdString = cProc.buildCommandDisplayTemplate(TID_INFO);
-				controllerStatus.serialState = SERIAL_READY_TO_SEND;
+				queueCommand(cProc.buildCommandDisplayTemplate(TID_INFO));
 				setPowerOffStatus(POWEROFF_NONE);
-				// Check the serial status
-				manageSerial();
 			}
 			break;
 		case CMD_YELLOW:
@@ -396,49 +697,226 @@ void parseIR(int infraredID) {
 	controllerStatus.lastKey = infraredID;
 }
 
+/**
+ \brief Queue a command to be sent to the control panel board.
+ 
+ The command frame is copied in the pending queue and the sending starts immediately
+ if the in-flight window has a free slot. Only the frame length bytes are sent. If the
+ queue is full the command is discarded and the board display state is no more known.
+ 
+ \param command The command frame
+ */
+void queueCommand(const commandFrame& command) {
+	if(command.length == 0)
+		return;	// Nothing to send
+
+	if(!pendingQueue.push(command)) {
+		fprintf(stderr, SERIAL_QUEUE_FULL);
+		cProc.invalidateMirror();
+		return;
+	} // No more room in the queue
+
+	fillWindow();
+	// Check the serial status
+	manageSerial();
+}
+
+/**
+ \brief Move the pending commands to the serial queue while the in-flight window
+ has free slots.
+ 
+ Every command is tagged with the sequence ID of its window slot, then the serial
+ status is set to send it.
+ */
+void fillWindow(void) {
+	commandFrame command;
+	int sequence;
+
+	while(!requestTracker.isFull() && pendingQueue.pop(command)) {
+		sequence = requestTracker.open();
+		if(!serialQueue.push(cProc.stampSequence(command, sequence))) {
+			requestTracker.acknowledge(sequence);
+			fprintf(stderr, SERIAL_QUEUE_FULL);
+			cProc.invalidateMirror();
+			continue;
+		} // The command can't be sent
+		controllerStatus.serialState = SERIAL_READY_TO_SEND;
+	} // Send the pending commands
+}
+
+/**
+ \brief Read the characters waiting on the UART and process the received frames.
+ 
+ The characters are stored in the receiver buffer so the frames split between
+ more reads or more frames arrived together are processed correctly.
+ */
+void readSerial(void) {
+	receivedFrame frame;
+
+	while(serialReceiver.receive(uart0_filestream) > 0) {
+		while(serialReceiver.nextFrame(frame))
+			dispatchFrame(frame);
+	} // Read all the waiting characters
+
+	// The released slots are used by the waiting commands
+	fillWindow();
+	manageSerial();
+}
+
+/**
+ \brief Dispatch a frame received from the control panel by its type.
+ 
+ The responses (starting with the RESPONSE_SEPARATOR in the ASCII lines or
+ LINK_RESPONSE frames) are matched with the commands waiting for the response.
+ The commands starting with CMD_SEPARATOR are requests originated by the board.
+ The ASCII lines can start with the sequence ID. Other lines (e.g. the board
+ debug messages) and corrupted binary frames are ignored.
+ 
+ \param frame The received frame
+ */
+void dispatchFrame(const receivedFrame& frame) {
+	LinkFrame link;
+	char message[LINK_MAX_STRING + 1];
+	int16_t parameter;
+	long value;
+	int sequence = NO_SEQUENCE;
+	const char* line = frame.data;
+
+	if(frame.isBinary) {
+		if(!link.decode((const uint8_t*)frame.data, frame.length))
+			return;	// Corrupted frame
+		if(link.getSequence() != LINK_NO_SEQUENCE)
+			sequence = link.getSequence();
+
+		switch(link.getType()) {
+			case LINK_RESPONSE:
+				if(link.readString(message, sizeof(message)))
+					responseReceived(sequence, message);
+				break;
+			case CMD_MASTER_REQUEST:
+				if(link.readInt16(parameter))
+					masterRequest(parameter);
+				break;
+			default:
+				break;
+		} // Binary frame types
+		return;
+	} // Binary frame
+
+	if( (line[0] == SEQUENCE_MARKER) && (frame.length > PARM_SEQUENCE_LEN) ) {
+		if(CommandProcessor::decodeField(line + 1, PARM_SEQUENCE_LEN, value))
+			sequence = (int)value;
+		line += PARM_SEQUENCE_LEN + 1;
+	} // Sequence ID
+
+	if(line[0] == RESPONSE_SEPARATOR[0]) {
+		responseReceived(sequence, line);
+	} // Response
+	else if(line[0] == CMD_SEPARATOR) {
+		switch(line[1]) {
+			case CMD_MASTER_REQUEST:
+				if( (line[2] == FIELD_SEPARATOR) &&
+						(strlen(line + 3) >= PARM_INTEGER_LEN) &&
+						CommandProcessor::decodeField(line + 3, PARM_INTEGER_LEN, value) )
+					masterRequest((int)value);
+				break;
+			default:
+				break;
+		} // Board requests
+	} // Board request
+}
+
+/**
+ \brief Process a response of the control panel to a command.
+ 
+ The in-flight slot of the command is released and, if the board has executed
+ the command, its display change is applied to the mirror. An error response
+ makes the board display state unknown. The response to the link mode request
+ completes the binary protocol negotiation.
+ 
+ \param sequence The sequence ID of the response or NO_SEQUENCE
+ \param message The response string
+ */
+void responseReceived(int sequence, const char* message) {
+	int result;
+	bool isExecuted;
+
+#ifdef __DEBUG
+	printf("UART>%i : %s\n", sequence, message);
+#endif
+	if(controllerStatus.linkMode == LINK_MODE_NEGOTIATING) {
+		if(strcmp(message, LINK_BINARY_ACK) == 0) {
+			controllerStatus.linkMode = LINK_MODE_BINARY;
+			cProc.setBinaryMode(true);
+		} // The board supports the binary protocol
+		else if(strncmp(message, LINK_BINARY_ACK, strlen(LINK_BINARY_ACK) - 1) == 0) {
+			controllerStatus.linkMode = LINK_MODE_ASCII;
+		} // Binary protocol refused
+	} // Link mode negotiation
+
+	isExecuted = CommandProcessor::decodeResult(message, result) && (result == COMMAND_OK);
+	if( (sequence != NO_SEQUENCE) && requestTracker.acknowledge(sequence) && isExecuted )
+		cProc.commitMirror(sequence);
+	if(!isExecuted)
+		cProc.invalidateMirror();
+
+	// Any response completes the board handshake
+	completeStartupStep(STARTUP_STEP_BOARD, true);
+}
+
+/**
+ \brief Answer a parameter request of the control panel.
+ 
+ \param parameterID The requested parameter ID
+ */
+void masterRequest(int parameterID) {
+	queueCommand(cProc.buildParameterCommand(parameterID));
+}
+
 /**
  \brief Manage the serial communication between the master and the control panel
  board.
  
- Depending on the serial flag status this function send the waiting command
- or check for the presence of an expected response from the remote system.
+ Depending on the serial flag status this function send the waiting commands
+ or check if all the responses from the remote system have been received.
+ The UART is non-blocking so the queue is written only until the UART accepts
+ bytes; in this case the UART writable event is enabled and the sending is
+ resumed by the event loop.
  
  \warning Use this function only when sure that the serial is connected and
  running as there are no controls on the serial status.
  */
 void manageSerial(void) {
-	int bytesWritten = 0;
-	char rx_buffer[MAX_CMD_LEN];
-	int rx_length;
-
 	switch(controllerStatus.serialState) {
 		case SERIAL_IDLE_STATUS:
 			// No action is required
 			break;
 			
 		case SERIAL_READY_TO_SEND:
-			// There is a command ready to send in the command string queue
-			bytesWritten = write(uart0_filestream, cmdString, MAX_CMD_LEN);
+			// There are commands ready to send in the command queue
+			if(serialQueue.flush(uart0_filestream) == -1) {
+				serialQueue.clear();
+				// No response will come: the window slots are released and
+				// the board state is no more known
+				requestTracker.clear();
+				cProc.invalidateMirror();
+			} // Write error, the waiting commands are lost
 			// Change the serial status accordingly to the action
-			controllerStatus.serialState = SERIAL_JUST_SENT;
+			if(serialQueue.isEmpty()) {
+				controllerStatus.serialState = SERIAL_JUST_SENT;
+				eventLoop.modifyWatch(uart0_filestream, EPOLLIN);
+			} // All sent, wait for the responses
+			else {
+				eventLoop.modifyWatch(uart0_filestream, EPOLLIN | EPOLLOUT);
+			} // Wait until the UART can accept more bytes
 			break;
 			
 		case SERIAL_JUST_SENT:
-			// The previous action a command string was sent to the remote board
-			// so check if an answer is arrived.
-			if (uart0_filestream != -1) {
-				rx_length = read(uart0_filestream, (void*)rx_buffer, MAX_CMD_LEN);
-				// Check if there are bytes waiting
-				if (rx_length > 0) {
-					//Bytes received
-					rx_buffer[rx_length] = '\0';
-#ifdef __DEBUG
-					printf("UART>%i bytes : %s\n", rx_length, rx_buffer);
-#endif
-					cmdString = rx_buffer;
-				} // Load the data read
-			} // Check for data on the uart buffer queue			
-			controllerStatus.serialState = SERIAL_IDLE_STATUS;
+			// The commands have been sent to the remote board and the responses
+			// are read by readSerial() when they arrive. The serial is idle when
+			// all the commands have been acknowledged or expired.
+			if(requestTracker.isEmpty() && pendingQueue.isEmpty())
+				controllerStatus.serialState = SERIAL_IDLE_STATUS;
 			break;
 			
 		default:
@@ -462,6 +940,30 @@ void initFlags(void) {
 	controllerStatus.powerOff = POWEROFF_NONE;
 	controllerStatus.lastKey = '\0';
 	controllerStatus.isMuted = false;
+	controllerStatus.linkMode = LINK_MODE_ASCII;
+}
+
+/**
+ \brief Enable a probe on the control panel board
+ 
+ The previously active probe is disabled. The enable commands are built by the
+ CommandProcessor only if the board probe status changes, so a probe selected
+ again does not send any command.
+ 
+ \param probe The probe to enable (PROBE_ACTIVE codes)
+ */
+void selectProbe(int probe) {
+	//! The probe subcommands, in the PROBE_ACTIVE codes order
+	static const char probeSubcommands[] = { CMD_NULLCHAR, S_STETHOSCOPE, S_ECG,
+			S_HEARTBEAT, S_BODYTEMP, S_PRESSURE };
+
+	if( (controllerStatus.activeProbe != PROBE_ACTIVE_NONE) &&
+			(controllerStatus.activeProbe != probe) )
+		queueCommand(cProc.buildEnableCommand(probeSubcommands[controllerStatus.activeProbe], false));
+	if(probe != PROBE_ACTIVE_NONE)
+		queueCommand(cProc.buildEnableCommand(probeSubcommands[probe], true));
+
+	controllerStatus.activeProbe = probe;
 }
 
 /**
@@ -498,8 +1000,6 @@ void setPowerOffStatus(int status) {
 			exit(0); // Application is terminated
 #else
 			// Initiate a shutdown sequence
-			// First dismount the remote folder
-			remoteMount_Umount(false);
 			exit(0);
 			//! \todo Shutdown sequence manager
 #endif
@@ -509,8 +1009,14 @@ void setPowerOffStatus(int status) {
 
 /**
  \brief Convert the program application strings to voice messages
+
+ Only the strings changed since the last conversion are converted (see the
+ TTSGenerator class). The audio files are then collected in the voice messages
+ pack played by the audio worker.
+
+ \return The number of failed conversions, including the pack creation
 */
-void ttsStrings(void) {
+int ttsStrings(void) {
 	
 	//! The strings array with the messages
 	const char * MESSAGES[TTS_MAX_MESSAGES] = { 
@@ -543,103 +1049,152 @@ void ttsStrings(void) {
 		"Continuous mode running. Press OK to stop collecting data."
 	};
 
+	TTSGenerator generator(MESSAGES, TTS_MAX_MESSAGES);
+	int failed;
+
 	printf(TTS_START_PROCESS);
 
-	// Generate the TTS wav files
-	for(int j = 0; j < TTS_MAX_MESSAGES; j++) {
+	// Generate the changed TTS wav files
+	failed = generator.generate();
+	printf(TTS_RESULT, generator.getConverted(), failed);
+
+	if(!AssetPack::build(TTS_FOLDER TTS_PACK, TTS_FOLDER, TTS_FORMAT, TTS_MAX_MESSAGES,
+			TTS_USE_ADPCM)) {
+		fprintf(stderr, TTS_PACK_ERROR);
+		failed++;
+	} // Pack error
 
-		char fileName[64];
-		char fileTemp[64];
-		char programName[32];
-		char programPath[64];
-		char messageText[1024];
+	return failed;
+}
+
+/**
+ \brief Measure the IMA-ADPCM encoding of the voice messages
 
+ For every voice message wav file in the TTS_FOLDER prints the PCM and the
+ encoded sizes, the encoding and decoding times and the signal to noise ratio
+ of the decoded samples. If no message exists a synthetic test clip is used.
+*/
+void audioBench(void) {
+	char fileName[64];
+	char name[16];
+	uint8_t* wav;
+	long length;
+	audioClip clip;
+	FILE* file;
+	bool isFound = false;
+
+	printf(TTS_BENCH_HEADER);
+
+	for(int j = 0; j < TTS_MAX_MESSAGES; j++) {
 		sprintf(fileName, "%s%d.%s", TTS_FOLDER, j + 1, TTS_FORMAT);
-		sprintf(fileTemp, "%d.tmp", j + 1);
-		sprintf(programName, "%s", TTS_SHELL_COMMAND);
-		sprintf(programPath, "%s", TTS_SHELL_PATH);
-		sprintf(messageText, "%s", MESSAGES[j]);
-
-		char* arg_list[] = {
-			programName,     // argv[0], the name of the program.
-			messageText,
-			fileName,
-			fileTemp,
-			NULL
-		  };
-		
-		// Spawn a child process running the command.  
-		// Ignore the returned child process id.
-		spawn (programPath, arg_list); 
-	}
+		file = fopen(fileName, "rb");
+		if(file == NULL)
+			continue;
+
+		fseek(file, 0, SEEK_END);
+		length = ftell(file);
+		rewind(file);
+		wav = (uint8_t*)malloc(length > 0 ? length : 1);
+		if( (wav != NULL) && (fread(wav, 1, length, file) == (size_t)length) &&
+				AudioCodec::parseWav(wav, length, &clip) ) {
+			sprintf(name, "%d", j + 1);
+			benchClip(name, clip);
+			isFound = true;
+		} // 16 bits mono wav file
+		free(wav);
+		fclose(file);
+	} // Measure the messages
+
+	if(!isFound) {
+		uint32_t numSamples = TTS_BENCH_RATE * 3;
+		wav = (uint8_t*)malloc(numSamples * 2);
+		if(wav == NULL)
+			return;
+
+		// A frequency sweep with a varying level, similar to a voice message
+		for(uint32_t j = 0; j < numSamples; j++) {
+			double t = (double)j / TTS_BENCH_RATE;
+			int16_t sample = (int16_t)(12000.0 * sin(t * 7.0) *
+					sin(2.0 * M_PI * (200.0 + 600.0 * t) * t));
+			wav[j * 2] = sample & 0xFF;
+			wav[j * 2 + 1] = (sample >> 8) & 0xFF;
+		} // Build the test clip
+
+		clip.samples = wav;
+		clip.numSamples = numSamples;
+		clip.sampleRate = TTS_BENCH_RATE;
+		printf(TTS_BENCH_SYNTHETIC);
+		benchClip("test", clip);
+		free(wav);
+	} // No messages
 }
 
 /**
- \brief Play a voice message on the remote RPIslave3 with the
- Cirrus Logic Audio Card.
- 
- \note To the Linux side the two computers should be set to share the
- private / public ssh key to avoid passing user and password during the
- ssh remote command launch
- 
- \param messageID The message ID to play remotely
+ \brief Measure the IMA-ADPCM encoding of a clip and print the results
+
+ \param name The clip name
+ \param clip The clip
 */
-void playRemoteMessage(int messageID) {
-	
-		char sshCall[64];
-		char sshServer[64];
-		char programName[32];
-		char programPath[64];
-
-		sprintf(programName, "%s", SSH_AUDIO_MESSAGE);
-		sprintf(programPath, "%s", SSH_AUDIO_MESSAGE_PATH);
-		sprintf(sshCall, "%d", messageID + 1);
-
-		char* arg_list[] = {
-			programName,
-			sshCall,
-			NULL
-		  };
-		
-		// Spawn a child process running the command.  
-		// Ignore the returned child process id.
-		spawn (programPath, arg_list); 
+void benchClip(const char* name, const audioClip& clip) {
+	uint32_t encodedLength = AudioCodec::encodedLength(clip.numSamples);
+	uint8_t* encoded = (uint8_t*)malloc(encodedLength);
+	int16_t* decoded = (int16_t*)malloc(clip.numSamples * sizeof(int16_t) + 1);
+	struct timespec start, end;
+	double encodeTime, decodeTime;
+	double signal = 0, noise = 0;
+
+	if( (encoded == NULL) || (decoded == NULL) ) {
+		free(encoded);
+		free(decoded);
+		return;
+	} // No memory
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(int j = 0; j < TTS_BENCH_REPEAT; j++)
+		encodedLength = AudioCodec::encode(clip, encoded);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	encodeTime = ((end.tv_sec - start.tv_sec) * 1e6 +
+			(end.tv_nsec - start.tv_nsec) / 1e3) / TTS_BENCH_REPEAT;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(int j = 0; j < TTS_BENCH_REPEAT; j++)
+		AudioCodec::decode(encoded, encodedLength, decoded);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	decodeTime = ((end.tv_sec - start.tv_sec) * 1e6 +
+			(end.tv_nsec - start.tv_nsec) / 1e3) / TTS_BENCH_REPEAT;
+
+	for(uint32_t j = 0; j < clip.numSamples; j++) {
+		double sample = (int16_t)(clip.samples[j * 2] | (clip.samples[j * 2 + 1] << 8));
+		signal += sample * sample;
+		noise += (sample - decoded[j]) * (sample - decoded[j]);
+	} // Compare the samples
+
+	printf(TTS_BENCH_ROW, name, clip.numSamples * 2, encodedLength,
+			(double)(clip.numSamples * 2) / encodedLength, encodeTime, decodeTime,
+			noise > 0 ? 10.0 * log10(signal / noise) : 99.9);
+
+	free(encoded);
+	free(decoded);
 }
 
 /**
- \brief Mount or umount the remote message folder to play audio messages with 
- the CLAC
+ \brief Play a voice message on the remote RPIslave3 with the
+ Cirrus Logic Audio Card.
+ 
+ The message is sent to the voice messages worker (see the AudioDispatcher
+ class) that plays it through the shared ssh connection. If the worker has
+ ended before its SIGCHLD is handled the message is lost and the worker
+ restart is scheduled.
  
  \note To the Linux side the two computers should be set to share the
  private / public ssh key to avoid passing user and password during the
  ssh remote command launch
  
- \param action Mount remotely the audio message folder if true, else umount it
+ \param messageID The message ID to play remotely
 */
-void remoteMount_Umount(bool action) {
-
-	char programName[64];
-	char programPath[64];
-
-	if(action) {
-		// Mount remote folder
-		sprintf(programName, "%s", SSH_FOLDER_MOUNT);
-		sprintf(programPath, "%s", SSH_FOLDER_MOUNT_PATH);
-	}
-	else {
-		// Umount remote folder
-		sprintf(programName, "%s", SSH_FOLDER_UMOUNT);
-		sprintf(programPath, "%s", SSH_FOLDER_UMOUNT_PATH);
-	}
-	
-	char* arg_list[] = {
-		programName,
-		NULL
-	  };
-
-	// Spawn a child process running the command.  
-	// Ignore the returned child process id.
-	spawn (programPath, arg_list); 
+void playRemoteMessage(int messageID) {
+	if(!audioDispatcher.play(messageID) && audioDispatcher.hasEnded())
+		scheduleAudioRestart();
 }
 
 /**
@@ -661,6 +1216,8 @@ int spawn (char* program, char** arg_list) {
     // This is the parent process ID
     return child_pid;
   else {
+    // The program should receive the signals blocked by the controller
+    AudioDispatcher::unblockSignals();
     // Now execute the program, searching for it in the path.
     execvp(program, arg_list);
 	
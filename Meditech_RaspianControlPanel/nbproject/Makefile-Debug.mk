@@ -35,9 +35,22 @@ OBJECTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}
 
 # Object Files
 OBJECTFILES= \
+	${OBJECTDIR}/AssetPack.o \
+	${OBJECTDIR}/AudioCodec.o \
+	${OBJECTDIR}/AudioDispatcher.o \
 	${OBJECTDIR}/CommandProcessor.o \
+	${OBJECTDIR}/DisplayMirror.o \
+	${OBJECTDIR}/DisplayScheduler.o \
+	${OBJECTDIR}/EventLoop.o \
+	${OBJECTDIR}/IRKeyMap.o \
 	${OBJECTDIR}/LCDTemplatesMaster.o \
-	${OBJECTDIR}/main.o
+	${OBJECTDIR}/LinkProtocol.o \
+	${OBJECTDIR}/main.o \
+	${OBJECTDIR}/RequestTracker.o \
+	${OBJECTDIR}/SerialQueue.o \
+	${OBJECTDIR}/SerialReceiver.o \
+	${OBJECTDIR}/StartupBarrier.o \
+	${OBJECTDIR}/TTSGenerator.o
 
 
 # C Compiler Flags
@@ -62,23 +75,88 @@ LDLIBSOPTIONS=
 
 ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/meditech_raspiancontrolpanel: ${OBJECTFILES}
 	${MKDIR} -p ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}
-	${LINK.cc} -o ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/meditech_raspiancontrolpanel ${OBJECTFILES} ${LDLIBSOPTIONS} -llirc_client
+	${LINK.cc} -o ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/meditech_raspiancontrolpanel ${OBJECTFILES} ${LDLIBSOPTIONS} -llirc_client -lrt
+
+${OBJECTDIR}/AssetPack.o: nbproject/Makefile-${CND_CONF}.mk AssetPack.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/AssetPack.o AssetPack.cpp
+
+${OBJECTDIR}/AudioCodec.o: nbproject/Makefile-${CND_CONF}.mk AudioCodec.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/AudioCodec.o AudioCodec.cpp
+
+${OBJECTDIR}/AudioDispatcher.o: nbproject/Makefile-${CND_CONF}.mk AudioDispatcher.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/AudioDispatcher.o AudioDispatcher.cpp
 
 ${OBJECTDIR}/CommandProcessor.o: nbproject/Makefile-${CND_CONF}.mk CommandProcessor.cpp 
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/CommandProcessor.o CommandProcessor.cpp
 
+${OBJECTDIR}/DisplayMirror.o: nbproject/Makefile-${CND_CONF}.mk DisplayMirror.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/DisplayMirror.o DisplayMirror.cpp
+
+${OBJECTDIR}/DisplayScheduler.o: nbproject/Makefile-${CND_CONF}.mk DisplayScheduler.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/DisplayScheduler.o DisplayScheduler.cpp
+
+${OBJECTDIR}/EventLoop.o: nbproject/Makefile-${CND_CONF}.mk EventLoop.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/EventLoop.o EventLoop.cpp
+
+${OBJECTDIR}/IRKeyMap.o: nbproject/Makefile-${CND_CONF}.mk IRKeyMap.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/IRKeyMap.o IRKeyMap.cpp
+
 ${OBJECTDIR}/LCDTemplatesMaster.o: nbproject/Makefile-${CND_CONF}.mk LCDTemplatesMaster.cpp 
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/LCDTemplatesMaster.o LCDTemplatesMaster.cpp
 
+${OBJECTDIR}/LinkProtocol.o: nbproject/Makefile-${CND_CONF}.mk LinkProtocol.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/LinkProtocol.o LinkProtocol.cpp
+
 ${OBJECTDIR}/main.o: nbproject/Makefile-${CND_CONF}.mk main.cpp 
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/main.o main.cpp
 
+${OBJECTDIR}/RequestTracker.o: nbproject/Makefile-${CND_CONF}.mk RequestTracker.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/RequestTracker.o RequestTracker.cpp
+
+${OBJECTDIR}/SerialQueue.o: nbproject/Makefile-${CND_CONF}.mk SerialQueue.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/SerialQueue.o SerialQueue.cpp
+
+${OBJECTDIR}/SerialReceiver.o: nbproject/Makefile-${CND_CONF}.mk SerialReceiver.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/SerialReceiver.o SerialReceiver.cpp
+
+${OBJECTDIR}/StartupBarrier.o: nbproject/Makefile-${CND_CONF}.mk StartupBarrier.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/StartupBarrier.o StartupBarrier.cpp
+
+${OBJECTDIR}/TTSGenerator.o: nbproject/Makefile-${CND_CONF}.mk TTSGenerator.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/TTSGenerator.o TTSGenerator.cpp
+
 # Subprojects
 .build-subprojects:
 